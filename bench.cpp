@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "pancyclic.h"
+
+using namespace std;
+
+// Every allocation in the program goes through here, so the benchmarks can report allocations per op
+// (aligned allocations aren't counted, but nothing measured here makes them)
+namespace
+{
+    atomic<unsigned long long> allocations(0);
+}
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1)) return ptr;
+    throw bad_alloc();
+}
+void* operator new[](size_t size) {return operator new(size);}
+void operator delete(void* ptr) noexcept {free(ptr);}
+void operator delete[](void* ptr) noexcept {free(ptr);}
+void operator delete(void* ptr, size_t) noexcept {free(ptr);}
+void operator delete[](void* ptr, size_t) noexcept {free(ptr);}
+
+namespace
+{
+    // The way get_graph_iso_num used to work: rebuild the graph for every rotation and reflection
+    GraphNumber naive_iso_num(Hamiltonian const& graph)
+    {
+        Hamiltonian copy = graph;
+        GraphNumber max = graph.get_graph_num();
+        for (int i = 0; i < 2 * graph.get_num_vertices() - 1; i++)
+        {
+            if (i == graph.get_num_vertices() - 1) copy.reflect();
+            else copy.rotate();
+            GraphNumber new_num = copy.get_graph_num();
+            if (new_num > max) max = new_num;
+        }
+        return max;
+    }
+
+    vector<Hamiltonian> random_graphs(int nvert, double density, int count, mt19937& rng)
+    {
+        bernoulli_distribution has_chord(density);
+        vector<Hamiltonian> graphs;
+        for (int i = 0; i < count; i++)
+        {
+            Hamiltonian graph(nvert);
+            for (int start = 0; start < nvert - 2; start++)
+            {
+                for (int end = start+2; end < nvert - (start ? 0 : 1); end++)
+                {
+                    if (has_chord(rng)) graph.add_chord(Chord(start, end, nvert));
+                }
+            }
+            graphs.push_back(graph);
+        }
+        return graphs;
+    }
+
+    // Returns ns per item
+    template<typename T, typename F>
+    double time_per_graph(vector<T> const& graphs, F func)
+    {
+        // Keeps the optimizer from throwing the work away
+        static volatile long sink;
+        auto const begin = chrono::steady_clock::now();
+        for (auto const& graph : graphs) sink = sink + func(graph).size();
+        auto const end = chrono::steady_clock::now();
+        return chrono::duration<double, nano>(end - begin).count() / graphs.size();
+    }
+
+    // Keeps the optimizer from throwing the work away
+    volatile unsigned long long sink;
+
+    struct Measurement
+    {
+        double ns_per_op;
+        double allocs_per_op;
+    };
+
+    // pass() does ops_per_pass ops and returns something to feed the sink
+    // The first pass warms up caches and thread_local buffers, the second counts allocations, and the time
+    // is the best of a few runs of at least min_ms each, which is steadier between runs than the mean
+    template<typename Pass>
+    Measurement measure(unsigned long long ops_per_pass, double min_ms, int runs, Pass pass)
+    {
+        sink = sink + pass();
+        unsigned long long const before = allocations.load();
+        sink = sink + pass();
+        Measurement ret;
+        ret.allocs_per_op = static_cast<double>(allocations.load() - before) / ops_per_pass;
+
+        ret.ns_per_op = numeric_limits<double>::infinity();
+        for (int run = 0; run < runs; run++)
+        {
+            unsigned long long passes = 0;
+            auto const begin = chrono::steady_clock::now();
+            double elapsed;
+            do
+            {
+                sink = sink + pass();
+                passes++;
+                elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+            } while (elapsed < min_ms);
+            ret.ns_per_op = min(ret.ns_per_op, elapsed * 1e6 / (passes * ops_per_pass));
+        }
+        return ret;
+    }
+}
+
+
+// The paths everything else is built on, one CSV row per op, n and density
+// Graphs come from a fixed seed and rows always come out in the same order, so the output of two commits
+// can be diffed or joined on (op, n, density)
+void bench_core(bool quick)
+{
+    const int num_graphs = quick ? 50 : 200;
+    const double min_ms = quick ? 2 : 20;
+    const int runs = quick ? 1 : 3;
+
+    cout << "op,n,density,unit,ns_per_op,allocs_per_op,ops_per_sec" << endl;
+    for (int nvert = 8; nvert <= 32; nvert += 4)
+    {
+        for (double density : {0.1, 0.3, 0.5})
+        {
+            // Seeded per set, so adding or dropping a set doesn't change the others
+            mt19937 rng(nvert * 1000 + static_cast<int>(density * 100));
+            auto const graphs = random_graphs(nvert, density, num_graphs, rng);
+            vector<vector<Chord>> chord_vecs;
+            vector<GraphNumber> nums;
+            unsigned long long total_chords = 0, total_pairs = 0;
+            for (auto const& graph : graphs)
+            {
+                chord_vecs.push_back(graph.chord_vector());
+                nums.push_back(graph.get_graph_num());
+                total_chords += graph.get_num_chords();
+                total_pairs += graph.get_num_chords() * (graph.get_num_chords() - 1ULL) / 2;
+            }
+
+            auto report = [&](char const* op, char const* unit, Measurement const& result)
+            {
+                cout << op << ',' << nvert << ',' << density << ',' << unit << ',' << result.ns_per_op << ','
+                     << result.allocs_per_op << ',' << 1e9 / result.ns_per_op << endl;
+            };
+
+            Hamiltonian scratch(nvert);
+            report("add_chord", "chord", measure(total_chords, min_ms, runs, [&]
+            {
+                unsigned long long ret = 0;
+                for (auto const& chords : chord_vecs)
+                {
+                    scratch.clear();
+                    for (Chord const& chord : chords) scratch.add_chord(chord);
+                    ret += scratch.get_num_chords();
+                }
+                return ret;
+            }));
+            report("chords", "chord", measure(total_chords, min_ms, runs, [&]
+            {
+                unsigned long long ret = 0;
+                for (auto const& graph : graphs) for (Chord const& chord : graph.chords()) ret += chord.get_end();
+                return ret;
+            }));
+            report("get_graph_num", "graph", measure(graphs.size(), min_ms, runs, [&]
+            {
+                unsigned long long ret = 0;
+                for (auto const& graph : graphs) ret += graph.get_graph_num()[0];
+                return ret;
+            }));
+            report("decode_graph_num", "graph", measure(graphs.size(), min_ms, runs, [&]
+            {
+                unsigned long long ret = 0;
+                for (auto const& num : nums) ret += Hamiltonian(nvert, num).get_num_chords();
+                return ret;
+            }));
+            report("get_graph_iso_num", "graph", measure(graphs.size(), min_ms, runs, [&]
+            {
+                unsigned long long ret = 0;
+                for (auto const& graph : graphs) ret += graph.get_graph_iso_num()[0];
+                return ret;
+            }));
+            report("get_crossing_components", "graph", measure(graphs.size(), min_ms, runs, [&]
+            {
+                unsigned long long ret = 0;
+                for (auto const& graph : graphs) ret += graph.get_crossing_components().size();
+                return ret;
+            }));
+            CrossingComponents comps;
+            report("crossing_components", "graph", measure(graphs.size(), min_ms, runs, [&]
+            {
+                unsigned long long ret = 0;
+                for (auto const& graph : graphs)
+                {
+                    graph.crossing_components(comps);
+                    ret += comps.size();
+                }
+                return ret;
+            }));
+            report("Chord::crossing", "pair", measure(max(total_pairs, 1ULL), min_ms, runs, [&]
+            {
+                unsigned long long ret = 0;
+                for (auto const& chords : chord_vecs)
+                {
+                    for (size_t i = 0; i < chords.size(); i++)
+                        for (size_t j = i + 1; j < chords.size(); j++) ret += chords[i].crossing(chords[j]);
+                }
+                return ret;
+            }));
+        }
+    }
+}
+
+
+void bench_canonical(mt19937& rng)
+{
+    const int num_graphs = 2000;
+
+    cout << "n,density,naive_ns,canonical_ns,speedup" << endl;
+    for (int nvert : {12, 16, 20, 24})
+    {
+        for (double density : {0.05, 0.2, 0.5})
+        {
+            auto graphs = random_graphs(nvert, density, num_graphs, rng);
+            double naive_ns = time_per_graph(graphs, naive_iso_num);
+            double canon_ns = time_per_graph(graphs, [](Hamiltonian const& g) {return g.get_graph_iso_num();});
+            cout << nvert << ',' << density << ',' << naive_ns << ',' << canon_ns << ',' << naive_ns / canon_ns << endl;
+        }
+    }
+}
+
+void bench_crossing(mt19937& rng)
+{
+    const int num_graphs = 50;
+
+    // Pairwise Chord::crossing is the baseline every kernel gets compared to
+    cout << endl << "n,density,chords,pairwise_ns,scalar_ns,avx2_ns" << endl;
+    for (int nvert : {16, 32, 64})
+    {
+        for (double density : {0.2, 0.5})
+        {
+            auto graphs = random_graphs(nvert, density, num_graphs, rng);
+            vector<vector<Chord>> chord_vecs;
+            for (auto const& graph : graphs) chord_vecs.push_back(graph.chord_vector());
+
+            auto pairwise = [](vector<Chord> const& chords)
+            {
+                vector<bool> matrix(chords.size() * chords.size());
+                for (size_t i = 0; i < chords.size(); i++)
+                    for (size_t j = 0; j < chords.size(); j++) matrix[i * chords.size() + j] = chords[i].crossing(chords[j]);
+                return matrix;
+            };
+            cout << nvert << ',' << density << ',' << graphs[0].get_num_chords() << ',' << time_per_graph(chord_vecs, pairwise);
+            for (auto kernel : {CrossingMatrix::SCALAR, CrossingMatrix::AVX2})
+            {
+                cout << ',';
+                if (!CrossingMatrix::kernel_supported(kernel)) cout << "NA";
+                else cout << time_per_graph(chord_vecs, [kernel](vector<Chord> const& chords) {return Chord::crossing_matrix(chords, kernel);});
+            }
+            cout << endl;
+        }
+    }
+}
+
+// Enumerating should find exactly as many classes per chord count as Burnside's lemma says there are
+void check_counts()
+{
+    cout << endl << "n,max_chords,enumerated,burnside,enumerate_ms,burnside_ms,match" << endl;
+    for (auto const& limits : vector<pair<int, int>>{{3, -1}, {4, -1}, {5, -1}, {6, -1}, {7, -1}, {8, -1}, {12, 4}, {20, 3}})
+    {
+        int const nvert = limits.first;
+        auto const begin = chrono::steady_clock::now();
+        ChordEnumerator gen(nvert, 0, limits.second);
+        vector<unsigned long long> found(Chord::max_num_chords(nvert) + 1);
+        gen.for_each([&found](Hamiltonian const& graph) {found[graph.get_num_chords()]++;});
+        auto const middle = chrono::steady_clock::now();
+        OrbitCounter counter(nvert);
+        auto const end = chrono::steady_clock::now();
+
+        bool match = true;
+        unsigned long long total = 0;
+        for (int chords = 0; chords <= gen.get_max_chords(); chords++)
+        {
+            total += found[chords];
+            match = match && counter.count(chords) == found[chords];
+        }
+        cout << nvert << ',' << gen.get_max_chords() << ',' << total << ',' << counter.count(0, limits.second) << ','
+             << chrono::duration<double, milli>(middle - begin).count() << ','
+             << chrono::duration<double, milli>(end - middle).count() << ',' << (match ? "yes" : "NO") << endl;
+    }
+}
+
+
+// Usage: pancyclic_bench [--quick] [--compare] [--counts] [--all]
+// With no options, only the core table is printed. --compare adds the old-vs-new canonicalization and crossing
+// kernel tables, and --counts checks enumeration against Burnside
+int main(int argc, char** argv)
+{
+    bool quick = false, compare = false, counts = false;
+    for (int arg = 1; arg < argc; arg++)
+    {
+        if (!strcmp(argv[arg], "--quick")) quick = true;
+        else if (!strcmp(argv[arg], "--compare")) compare = true;
+        else if (!strcmp(argv[arg], "--counts")) counts = true;
+        else if (!strcmp(argv[arg], "--all")) compare = counts = true;
+        else
+        {
+            cerr << "Usage: " << argv[0] << " [--quick] [--compare] [--counts] [--all]" << endl;
+            return 1;
+        }
+    }
+
+    bench_core(quick);
+    mt19937 rng(12345);
+    if (compare)
+    {
+        cout << endl;
+        bench_canonical(rng);
+        bench_crossing(rng);
+    }
+    if (counts) check_counts();
+    // Only says anything in a PANCYCLIC_INSTRUMENT build
+    if (Instrumentation::enabled)
+    {
+        Instrumentation::dump_json(cerr);
+        cerr << endl;
+    }
+    return 0;
+}
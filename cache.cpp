@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "pancyclic.h"
+
+namespace
+{
+    std::atomic<std::size_t> global_capacity(0);
+    std::mutex global_mutex;
+    // Caches are never deleted once made, so pointers to them stay good however the capacity changes
+    std::unordered_map<int, std::unique_ptr<CanonicalCache>> global_caches;
+}
+
+
+CanonicalCache::CanonicalCache(int nvert, std::size_t capacity, int num_shards) :
+    num_vertices(nvert), capacity(capacity), canon(&Canonicalizer::for_vertices(nvert))
+{
+    num_words = canon->get_num_words();
+    if (num_shards <= 0) num_shards = 4 * std::max(1u, std::thread::hardware_concurrency());
+    // The shard count doesn't depend on the capacity, since set_capacity can grow a cache that started out small
+    // (the global ones start at whatever the first capacity was) and the shards are fixed once made
+    for (int shard = 0; shard < num_shards; shard++) shards.emplace_back(new Shard);
+    for (auto& shard : shards) reset(*shard, entries_per_shard(capacity));
+}
+
+void CanonicalCache::reset(Shard& shard, std::size_t entries) const
+{
+    shard.raw.assign(entries * num_words, 0);
+    shard.canonical.assign(entries * num_words, 0);
+    shard.hashes.assign(entries, 0);
+    shard.elements.assign(entries, 0);
+    shard.states.assign(entries, 0);
+    std::size_t index_size = 2;
+    while (index_size < 2 * entries) index_size *= 2;
+    shard.index.assign(index_size, 0);
+    shard.hand = 0;
+    shard.count = 0;
+    shard.hits = 0;
+    shard.misses = 0;
+}
+
+void CanonicalCache::set_capacity(std::size_t capacity)
+{
+    this->capacity.store(capacity, std::memory_order_relaxed);
+    for (auto& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        reset(*shard, entries_per_shard(capacity));
+    }
+}
+
+void CanonicalCache::clear()
+{
+    for (auto& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        reset(*shard, shard->states.size());
+    }
+}
+
+std::size_t CanonicalCache::find_slot(Shard const& shard, std::size_t hash, word_type const* words) const
+{
+    std::size_t const mask = shard.index.size() - 1;
+    for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        std::uint32_t const entry = shard.index[slot];
+        if (!entry) return slot;
+        if (shard.hashes[entry - 1] == hash && GraphNumber::compare(&shard.raw[(entry - 1) * num_words], words, num_words) == 0)
+            return slot;
+    }
+}
+
+void CanonicalCache::erase_slot(Shard& shard, std::size_t slot) const
+{
+    // Shift later entries back into the hole, unless that would put them before their home slot,
+    // so lookups never need tombstones
+    std::size_t const mask = shard.index.size() - 1;
+    shard.index[slot] = 0;
+    for (std::size_t next = (slot + 1) & mask; shard.index[next]; next = (next + 1) & mask)
+    {
+        std::size_t const home = shard.hashes[shard.index[next] - 1] & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+            shard.index[slot] = shard.index[next];
+            shard.index[next] = 0;
+            slot = next;
+        }
+    }
+}
+
+std::size_t CanonicalCache::evict(Shard& shard) const
+{
+    std::size_t const entries = shard.states.size();
+    while (shard.states[shard.hand] == 2)
+    {
+        shard.states[shard.hand] = 1;
+        shard.hand = (shard.hand + 1) % entries;
+    }
+    std::size_t const entry = shard.hand;
+    shard.hand = (shard.hand + 1) % entries;
+
+    if (shard.states[entry])
+    {
+        std::size_t const mask = shard.index.size() - 1;
+        std::size_t slot = shard.hashes[entry] & mask;
+        while (shard.index[slot] != entry + 1) slot = (slot + 1) & mask;
+        erase_slot(shard, slot);
+        shard.states[entry] = 0;
+        shard.count--;
+    }
+    return entry;
+}
+
+int CanonicalCache::canonical_form(word_type const* words, word_type* out)
+{
+    std::size_t const hash = GraphNumber::hash(words, num_words);
+    // The index uses the bottom bits of the hash, so pick the shard with the top ones
+    Shard& shard = *shards[(hash >> 32) % shards.size()];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.states.empty()) return canon->canonical_form(words, out);
+        std::size_t const slot = find_slot(shard, hash, words);
+        if (shard.index[slot])
+        {
+            std::size_t const entry = shard.index[slot] - 1;
+            shard.states[entry] = 2;
+            std::copy(&shard.canonical[entry * num_words], &shard.canonical[(entry + 1) * num_words], out);
+            shard.hits++;
+            return shard.elements[entry];
+        }
+        shard.misses++;
+    }
+
+    // Other threads can use the shard while this one works, and if two miss on the same graph, only one keeps it
+    int const element = canon->canonical_form(words, out);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.states.empty() || shard.index[find_slot(shard, hash, words)]) return element;
+    std::size_t const entry = evict(shard);
+    std::copy(words, words + num_words, &shard.raw[entry * num_words]);
+    std::copy(out, out + num_words, &shard.canonical[entry * num_words]);
+    shard.hashes[entry] = hash;
+    shard.elements[entry] = element;
+    shard.states[entry] = 1;
+    shard.count++;
+    // Evicting can shift the index around, so find the slot again
+    shard.index[find_slot(shard, hash, words)] = entry + 1;
+    return element;
+}
+
+GraphNumber CanonicalCache::canonical_form(GraphNumber const& num, Dihedral* element)
+{
+    if (num.size() != num_words) throw std::invalid_argument("Graph number is the wrong size for the cache");
+    GraphNumber out(num_words);
+    int const found = canonical_form(num.data(), out.data());
+    if (element) *element = Dihedral(num_vertices, found);
+    return out;
+}
+
+std::size_t CanonicalCache::size() const
+{
+    std::size_t total = 0;
+    for (auto const& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->count;
+    }
+    return total;
+}
+
+unsigned long long int CanonicalCache::hits() const
+{
+    unsigned long long int total = 0;
+    for (auto const& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->hits;
+    }
+    return total;
+}
+
+unsigned long long int CanonicalCache::misses() const
+{
+    unsigned long long int total = 0;
+    for (auto const& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->misses;
+    }
+    return total;
+}
+
+void CanonicalCache::set_global_capacity(std::size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(global_mutex);
+    global_capacity.store(capacity);
+    for (auto& entry : global_caches) entry.second->set_capacity(capacity);
+}
+
+CanonicalCache* CanonicalCache::global(int nvert)
+{
+    std::size_t const capacity = global_capacity.load(std::memory_order_relaxed);
+    if (!capacity) return nullptr;
+
+    // Same trick as Canonicalizer::for_vertices
+    thread_local CanonicalCache* last = nullptr;
+    if (last && last->num_vertices == nvert) return last;
+
+    std::lock_guard<std::mutex> lock(global_mutex);
+    auto& entry = global_caches[nvert];
+    if (!entry) entry.reset(new CanonicalCache(nvert, capacity));
+    last = entry.get();
+    return last;
+}
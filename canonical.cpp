@@ -0,0 +1,201 @@
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include "pancyclic.h"
+
+Canonicalizer::Canonicalizer(int nvert) : num_vertices(nvert), num_chords(Chord::max_num_chords(nvert))
+{
+    num_words = num_chords / word_bits + (num_chords % word_bits ? 1 : 0);
+    preimage.resize(get_group_order() * num_chords);
+    image.resize(get_group_order() * num_chords);
+
+    // Push every chord through every group element using the same Chord transforms as Hamiltonian::rotate/reflect
+    std::uint32_t idx = 0;
+    for (int start = 0; start < num_vertices - 2; start++)
+    {
+        for (int end = start+2; end < num_vertices - (start ? 0 : 1); end++, idx++)
+        {
+            for (int element = 0; element < get_group_order(); element++)
+            {
+                Chord image(start, end, num_vertices);
+                if (element >= num_vertices) image.reflect();
+                image.rotate(element % num_vertices);
+                auto const moved = image.index();
+                preimage[element * num_chords + moved] = idx;
+                this->image[element * num_chords + idx] = moved;
+            }
+        }
+    }
+}
+
+Canonicalizer const& Canonicalizer::for_vertices(int nvert)
+{
+    // Most callers hammer the same n over and over, so skip the lock when it's the same as last time
+    thread_local Canonicalizer const* last = nullptr;
+    if (last && last->num_vertices == nvert) return *last;
+
+    static std::mutex cache_mutex;
+    static std::unordered_map<int, std::unique_ptr<Canonicalizer>> cache;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto& entry = cache[nvert];
+    if (!entry) entry.reset(new Canonicalizer(nvert));
+    last = entry.get();
+    return *last;
+}
+
+Canonicalizer::word_type Canonicalizer::image_word(std::uint32_t const* perm, word_type const* words, unsigned int word) const
+{
+    unsigned long int const first = static_cast<unsigned long int>(word) * word_bits;
+    unsigned long int const last = std::min<unsigned long int>(first + word_bits, num_chords);
+
+    word_type ret = 0;
+    for (unsigned long int idx = first; idx < last; idx++)
+    {
+        std::uint32_t const src = perm[idx];
+        ret |= ((words[src / word_bits] >> (src % word_bits)) & 1) << (idx - first);
+    }
+    return ret;
+}
+
+unsigned long int Canonicalizer::list_chords(word_type const* words, std::uint32_t* set_chords) const
+{
+    unsigned long int count = 0;
+    for (unsigned int word = 0; word < num_words; word++)
+    {
+        for (word_type bits = words[word]; bits; bits &= bits - 1)
+            set_chords[count++] = word * word_bits + __builtin_ctzll(bits);
+    }
+    return count;
+}
+
+void Canonicalizer::scatter(std::uint32_t const* perm, std::uint32_t const* set_chords, unsigned long int count, word_type* out) const
+{
+    std::fill(out, out + num_words, 0);
+    for (unsigned long int i = 0; i < count; i++)
+    {
+        std::uint32_t const dst = perm[set_chords[i]];
+        out[dst / word_bits] |= word_type(1) << (dst % word_bits);
+    }
+}
+
+void Canonicalizer::transform(int element, word_type const* words, word_type* out) const
+{
+    std::uint32_t const* perm = image.data() + element * num_chords;
+    std::fill(out, out + num_words, 0);
+    for (unsigned int word = 0; word < num_words; word++)
+    {
+        for (word_type bits = words[word]; bits; bits &= bits - 1)
+        {
+            std::uint32_t const dst = perm[word * word_bits + __builtin_ctzll(bits)];
+            out[dst / word_bits] |= word_type(1) << (dst % word_bits);
+        }
+    }
+}
+
+int Canonicalizer::canonical_form(word_type const* words, word_type* out) const
+{
+    std::copy(words, words + num_words, out);
+    int best = 0;
+
+    unsigned long int graph_chords = 0;
+    for (unsigned int word = 0; word < num_words; word++) graph_chords += __builtin_popcountll(words[word]);
+
+    if (use_scatter(graph_chords))
+    {
+        std::uint32_t set_chords[word_bits];
+        thread_local std::vector<word_type> candidate;
+        candidate.resize(num_words);
+        list_chords(words, set_chords);
+
+        for (int element = 1; element < get_group_order(); element++)
+        {
+            scatter(image.data() + element * num_chords, set_chords, graph_chords, candidate.data());
+            for (unsigned int word = num_words; word-- > 0;)
+            {
+                if (candidate[word] < out[word]) break;
+                if (candidate[word] > out[word])
+                {
+                    std::copy(candidate.begin(), candidate.begin() + word + 1, out);
+                    best = element;
+                    break;
+                }
+            }
+        }
+        return best;
+    }
+
+    // Element 0 is the identity, which is already in out
+    for (int element = 1; element < get_group_order(); element++)
+    {
+        std::uint32_t const* perm = preimage.data() + element * num_chords;
+        bool bigger = false;
+        for (unsigned int word = num_words; word-- > 0;)
+        {
+            word_type const candidate = image_word(perm, words, word);
+            if (!bigger)
+            {
+                if (candidate < out[word]) break;
+                if (candidate > out[word]) bigger = true;
+            }
+            // Once the candidate has won, the rest of it just has to be copied in
+            if (bigger) out[word] = candidate;
+        }
+        if (bigger) best = element;
+    }
+    return best;
+}
+
+GraphNumber Canonicalizer::canonical_form(GraphNumber const& num) const
+{
+    if (num.size() != num_words) throw std::invalid_argument("Graph number is the wrong size for the canonicalizer");
+    GraphNumber out(num_words);
+    canonical_form(num.data(), out.data());
+    return out;
+}
+
+bool Canonicalizer::is_canonical(GraphNumber const& num) const
+{
+    if (num.size() != num_words) throw std::invalid_argument("Graph number is the wrong size for the canonicalizer");
+    return is_canonical(num.data());
+}
+
+bool Canonicalizer::is_canonical(word_type const* words) const
+{
+    unsigned long int graph_chords = 0;
+    for (unsigned int word = 0; word < num_words; word++) graph_chords += __builtin_popcountll(words[word]);
+
+    if (use_scatter(graph_chords))
+    {
+        std::uint32_t set_chords[word_bits];
+        thread_local std::vector<word_type> candidate;
+        candidate.resize(num_words);
+        list_chords(words, set_chords);
+
+        for (int element = 1; element < get_group_order(); element++)
+        {
+            scatter(image.data() + element * num_chords, set_chords, graph_chords, candidate.data());
+            for (unsigned int word = num_words; word-- > 0;)
+            {
+                if (candidate[word] > words[word]) return false;
+                if (candidate[word] < words[word]) break;
+            }
+        }
+        return true;
+    }
+
+    for (int element = 1; element < get_group_order(); element++)
+    {
+        std::uint32_t const* perm = preimage.data() + element * num_chords;
+        for (unsigned int word = num_words; word-- > 0;)
+        {
+            word_type const candidate = image_word(perm, words, word);
+            if (candidate > words[word]) return false;
+            if (candidate < words[word]) break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "pancyclic.h"
+
+#ifdef _WIN32
+#define PANCYCLIC_NO_MMAP
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    struct FileCloser
+    {
+        void operator()(std::FILE* file) const {if (file) std::fclose(file);}
+    };
+    using File = std::unique_ptr<std::FILE, FileCloser>;
+
+    void write_all(std::FILE* file, void const* data, std::size_t bytes)
+    {
+        if (bytes && std::fwrite(data, 1, bytes, file) != bytes) throw std::runtime_error("Couldn't write catalog");
+    }
+
+    void release(void* mapping, std::size_t size)
+    {
+#ifdef PANCYCLIC_NO_MMAP
+        std::free(mapping);
+#else
+        munmap(mapping, size);
+#endif
+    }
+}
+
+
+std::uint64_t Catalog::properties_of(Hamiltonian const& graph)
+{
+    std::uint64_t props = static_cast<std::uint64_t>(graph.get_num_crossing_components()) << component_shift;
+    if (graph.get_num_vertices() <= 64 && graph.is_pancyclic()) props |= PANCYCLIC;
+    return props;
+}
+
+Catalog::Catalog(std::string const& path) : mapping(nullptr), mapping_size(0)
+{
+#ifdef PANCYCLIC_NO_MMAP
+    // No mmap here, so just read the whole thing in
+    File file(std::fopen(path.c_str(), "rb"));
+    if (!file) throw std::runtime_error("Couldn't open catalog " + path);
+    std::fseek(file.get(), 0, SEEK_END);
+    mapping_size = std::ftell(file.get());
+    std::fseek(file.get(), 0, SEEK_SET);
+    mapping = std::malloc(mapping_size ? mapping_size : 1);
+    if (std::fread(mapping, 1, mapping_size, file.get()) != mapping_size)
+    {
+        release(mapping, mapping_size);
+        throw std::runtime_error("Couldn't read catalog " + path);
+    }
+#else
+    int const fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Couldn't open catalog " + path);
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        throw std::runtime_error("Couldn't read catalog " + path);
+    }
+    mapping_size = info.st_size;
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) throw std::runtime_error("Couldn't map catalog " + path);
+#endif
+
+    header = static_cast<Header const*>(mapping);
+    if (!valid_mapping())
+    {
+        release(mapping, mapping_size);
+        throw std::runtime_error(path + " isn't a catalog");
+    }
+}
+
+bool Catalog::valid_mapping()
+{
+    // Everything the lookups rely on is checked before it's used, with every size worked out so it can't
+    // overflow, so a corrupt or truncated file is turned away instead of read out of bounds
+    if (mapping_size < sizeof(Header) || std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version)
+        return false;
+    if (header->flags & ~HAS_PROPERTIES) return false;
+    std::uint64_t const nvert = header->num_vertices;
+    // Anything past what Chord supports in a header is taken as corruption
+    if (nvert < 4 || nvert > static_cast<std::uint64_t>(Chord::max_vertices)) return false;
+    if (header->max_chords != nvert * (nvert - 3) / 2) return false;
+    if (header->num_words != GraphNumber::for_vertices(nvert).size()) return false;
+
+    std::uint64_t const offset_bytes = (header->max_chords + 2) * sizeof(std::uint64_t);
+    if (offset_bytes > mapping_size - sizeof(Header)) return false;
+    offsets = reinterpret_cast<std::uint64_t const*>(header + 1);
+    if (offsets[0] != 0 || offsets[header->max_chords + 1] != header->num_graphs) return false;
+    for (std::uint64_t chords = 0; chords <= header->max_chords; chords++)
+    {
+        if (offsets[chords] > offsets[chords + 1]) return false;
+    }
+
+    stride = header->num_words + (has_properties() ? 1 : 0);
+    std::uint64_t const room = mapping_size - sizeof(Header) - offset_bytes;
+    if (stride && header->num_graphs > room / (stride * sizeof(word_type))) return false;
+    records = reinterpret_cast<word_type const*>(offsets + header->max_chords + 2);
+    return true;
+}
+
+Catalog::~Catalog() {release(mapping, mapping_size);}
+
+std::pair<std::size_t, std::size_t> Catalog::chord_count_range(int chords) const
+{
+    if (chords < 0 || static_cast<std::uint64_t>(chords) > header->max_chords) return {0, 0};
+    return {offsets[chords], offsets[chords + 1]};
+}
+
+std::size_t Catalog::lower_bound(int chords, word_type const* key) const
+{
+    auto range = chord_count_range(chords);
+    while (range.first < range.second)
+    {
+        std::size_t const mid = range.first + (range.second - range.first) / 2;
+        if (GraphNumber::compare(words(mid), key, get_num_words()) < 0) range.first = mid + 1;
+        else range.second = mid;
+    }
+    return range.first;
+}
+
+std::size_t Catalog::find(GraphNumber const& num) const
+{
+    // Anything set past the catalog's words can't be a graph on this many vertices
+    unsigned int const num_words = get_num_words();
+    for (unsigned int word = num_words; word < num.size(); word++) if (num[word]) return npos;
+
+    // Compares against the mapped records where they are, with any words past the end of a short key as zeros
+    unsigned int const key_words = std::min(num.size(), num_words);
+    auto const order = [&](std::size_t idx)
+    {
+        word_type const* const record = words(idx);
+        for (unsigned int word = num_words; word-- > key_words;) if (record[word]) return 1;
+        return GraphNumber::compare(record, num.data(), key_words);
+    };
+    auto range = chord_count_range(num.popcount());
+    while (range.first < range.second)
+    {
+        std::size_t const mid = range.first + (range.second - range.first) / 2;
+        if (order(mid) < 0) range.first = mid + 1;
+        else range.second = mid;
+    }
+    if (range.first == chord_count_range(num.popcount()).second || order(range.first) != 0) return npos;
+    return range.first;
+}
+
+
+CatalogWriter::CatalogWriter(std::string const& path, int nvert, bool with_properties) :
+    path(path), num_vertices(nvert), with_properties(with_properties), started(false), finished(false)
+{
+    // Below 4 vertices there are no chords, so records would have no words to tell them apart or count them by
+    if (nvert < 4) throw std::invalid_argument("Catalogs need at least 4 vertices");
+    num_words = GraphNumber::for_vertices(nvert).size();
+    for (unsigned long int chords = 0; chords <= Chord::max_num_chords(nvert); chords++) spools.emplace_back(new Spool);
+}
+
+CatalogWriter::~CatalogWriter()
+{
+    if (finished) return;
+    remove_spools();
+    if (started) std::remove(path.c_str());
+}
+
+void CatalogWriter::remove_spools()
+{
+    for (std::size_t chords = 0; chords < spools.size(); chords++)
+    {
+        Spool& spool = *spools[chords];
+        if (spool.file) std::fclose(spool.file);
+        spool.file = nullptr;
+        if (spool.created) std::remove(spool_path(chords).c_str());
+        spool.created = false;
+    }
+}
+
+void CatalogWriter::append(Hamiltonian const& graph, std::uint64_t properties)
+{
+    if (graph.get_num_vertices() != num_vertices)
+        throw std::invalid_argument("Hamiltonian has a different number of vertices than the catalog");
+    append(graph.get_graph_num(), properties);
+}
+
+void CatalogWriter::append(GraphNumber const& num, std::uint64_t properties)
+{
+    if (num.size() != num_words) throw std::invalid_argument("Graph number is the wrong size for the catalog");
+    if (finished) throw std::logic_error("Catalog is already finished");
+
+    Spool& spool = *spools[num.popcount()];
+    std::lock_guard<std::mutex> lock(spool.mutex);
+    if (!spool.file)
+    {
+        spool.file = std::fopen(spool_path(num.popcount()).c_str(), "wb");
+        if (!spool.file) throw std::runtime_error("Couldn't open catalog spool " + spool_path(num.popcount()));
+        spool.created = true;
+    }
+    write_all(spool.file, num.data(), num_words * sizeof(word_type));
+    if (with_properties) write_all(spool.file, &properties, sizeof(properties));
+}
+
+std::uint64_t CatalogWriter::finish()
+{
+    if (finished) throw std::logic_error("Catalog is already finished");
+
+    File out(std::fopen(path.c_str(), "wb"));
+    if (!out) throw std::runtime_error("Couldn't open catalog " + path);
+    started = true;
+
+    Catalog::Header header = {};
+    std::copy(Catalog::magic, Catalog::magic + sizeof(Catalog::magic), header.magic);
+    header.version = Catalog::version;
+    header.num_vertices = num_vertices;
+    header.num_words = num_words;
+    header.flags = with_properties ? Catalog::HAS_PROPERTIES : 0;
+    header.max_chords = spools.size() - 1;
+    std::vector<std::uint64_t> offsets(spools.size() + 1, 0);
+
+    // Leave room for the header and offsets, which are only known at the end
+    write_all(out.get(), &header, sizeof(header));
+    write_all(out.get(), offsets.data(), offsets.size() * sizeof(std::uint64_t));
+
+    unsigned int const stride = num_words + (with_properties ? 1 : 0);
+    std::vector<word_type> records;
+    std::vector<std::size_t> order;
+    for (std::size_t chords = 0; chords < spools.size(); chords++)
+    {
+        offsets[chords + 1] = offsets[chords];
+        Spool& spool = *spools[chords];
+        if (!spool.file) continue;
+        std::fclose(spool.file);
+        spool.file = nullptr;
+
+        File in(std::fopen(spool_path(chords).c_str(), "rb"));
+        if (!in) throw std::runtime_error("Couldn't reopen catalog spool " + spool_path(chords));
+        std::fseek(in.get(), 0, SEEK_END);
+        std::size_t const count = std::ftell(in.get()) / (stride * sizeof(word_type));
+        std::fseek(in.get(), 0, SEEK_SET);
+        records.resize(count * stride);
+        if (std::fread(records.data(), sizeof(word_type), records.size(), in.get()) != records.size())
+            throw std::runtime_error("Couldn't read catalog spool " + spool_path(chords));
+        in.reset();
+        std::remove(spool_path(chords).c_str());
+        spool.created = false;
+
+        // Sort an index rather than moving whole records around, then write them out in order
+        auto const less = [&](std::size_t a, std::size_t b)
+        {return GraphNumber::compare(&records[a * stride], &records[b * stride], num_words) < 0;};
+        auto const same = [&](std::size_t a, std::size_t b)
+        {return GraphNumber::compare(&records[a * stride], &records[b * stride], num_words) == 0;};
+        order.resize(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), less);
+        order.erase(std::unique(order.begin(), order.end(), same), order.end());
+
+        for (std::size_t idx : order) write_all(out.get(), &records[idx * stride], stride * sizeof(word_type));
+        offsets[chords + 1] += order.size();
+    }
+
+    header.num_graphs = offsets.back();
+    std::fseek(out.get(), 0, SEEK_SET);
+    write_all(out.get(), &header, sizeof(header));
+    write_all(out.get(), offsets.data(), offsets.size() * sizeof(std::uint64_t));
+    if (std::fclose(out.release()) != 0) throw std::runtime_error("Couldn't write catalog " + path);
+
+    finished = true;
+    return header.num_graphs;
+}
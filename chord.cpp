@@ -1,26 +1,6 @@
 #include <stdexcept>
 #include "pancyclic.h"
 
-void Chord::reorder()
-{
-    start %= num_vertices;
-    if (start < 0) start += num_vertices;
-    end %= num_vertices;
-    if (end < 0) end += num_vertices;
-    if (end < start)
-    {
-        int tmp = start;
-        start = end;
-        end = tmp;
-    }
-}
-
-Chord::Chord() : num_vertices(0), start(0), end(0) {}
-
-Chord::Chord(int start, int end, int nvert) : start(start), end(end), num_vertices(nvert) {reorder();}
-
-Chord::Chord(Chord const& other) : start(other.start), end(other.end), num_vertices(other.num_vertices) {}
-
 void Chord::rotate(int rotate)
 {
     start += rotate;
@@ -67,6 +47,3 @@ std::ostream& operator<<(std::ostream& os, Chord const& chord)
         ", end: " << chord.end << ")";
 }
 
-
-unsigned long int Chord::max_num_chords(int nvert)
-{return nvert * (nvert - 3) / 2;}
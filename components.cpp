@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <vector>
+#include "pancyclic.h"
+
+Hamiltonian CrossingComponents::to_hamiltonian(std::size_t comp) const
+{
+    Component const chords = (*this)[comp];
+    return Hamiltonian::from_iter(num_vertices, chords.begin(), chords.end());
+}
+
+std::vector<Hamiltonian> CrossingComponents::to_hamiltonians() const
+{
+    std::vector<Hamiltonian> ret_vec;
+    ret_vec.reserve(size());
+    for (std::size_t comp = 0; comp < size(); comp++) ret_vec.push_back(to_hamiltonian(comp));
+    return ret_vec;
+}
+
+
+template<typename ForEachChord>
+void ComponentTree::build(int nvert, std::size_t num_comps, ForEachChord for_each_chord)
+{
+    num_vertices = nvert;
+    scratch.chord_comps.clear();
+    scratch.chord_ends.clear();
+    for_each_chord([this](Chord const& chord, int comp)
+    {
+        scratch.chord_comps.push_back(comp);
+        scratch.chord_ends.push_back(chord.get_start());
+        scratch.chord_comps.push_back(comp);
+        scratch.chord_ends.push_back(chord.get_end());
+    });
+
+    // Bucket the components by the vertices they touch, so going round the cycle once lists every
+    // component's endpoints in order
+    scratch.vertex_offsets.assign(num_vertices + 1, 0);
+    for (int end : scratch.chord_ends) scratch.vertex_offsets[end + 1]++;
+    for (int vertex = 0; vertex < num_vertices; vertex++) scratch.vertex_offsets[vertex + 1] += scratch.vertex_offsets[vertex];
+    scratch.touching.resize(scratch.chord_ends.size());
+    {
+        // Borrow last_seen as the fill pointers
+        scratch.last_seen.assign(scratch.vertex_offsets.begin(), scratch.vertex_offsets.end() - 1);
+        for (std::size_t end = 0; end < scratch.chord_ends.size(); end++)
+            scratch.touching[scratch.last_seen[scratch.chord_ends[end]]++] = scratch.chord_comps[end];
+    }
+
+    // Chords in the same component can share endpoints, so count each vertex once per component
+    endpoint_offsets.assign(num_comps + 1, 0);
+    scratch.last_seen.assign(num_comps, -1);
+    for (int vertex = 0; vertex < num_vertices; vertex++)
+    {
+        for (unsigned int idx = scratch.vertex_offsets[vertex]; idx < scratch.vertex_offsets[vertex + 1]; idx++)
+        {
+            int const comp = scratch.touching[idx];
+            if (scratch.last_seen[comp] == vertex) continue;
+            scratch.last_seen[comp] = vertex;
+            endpoint_offsets[comp + 1]++;
+        }
+    }
+    for (std::size_t comp = 0; comp < num_comps; comp++) endpoint_offsets[comp + 1] += endpoint_offsets[comp];
+    endpoints.resize(endpoint_offsets.back());
+    scratch.last_seen.assign(num_comps, -1);
+    // order doubles as the fill pointers here, before it's needed for the order
+    scratch.order.assign(endpoint_offsets.begin(), endpoint_offsets.end() - 1);
+    for (int vertex = 0; vertex < num_vertices; vertex++)
+    {
+        for (unsigned int idx = scratch.vertex_offsets[vertex]; idx < scratch.vertex_offsets[vertex + 1]; idx++)
+        {
+            int const comp = scratch.touching[idx];
+            if (scratch.last_seen[comp] == vertex) continue;
+            scratch.last_seen[comp] = vertex;
+            endpoints[scratch.order[comp]++] = vertex;
+        }
+    }
+
+    // Outer components come before the ones inside them: lowest endpoint first, then highest endpoint last
+    // The only tie is a single chord with the same ends as a bigger component, which it goes round, so it goes first
+    auto lowest = [this](int comp) {return endpoints[endpoint_offsets[comp]];};
+    auto highest = [this](int comp) {return endpoints[endpoint_offsets[comp + 1] - 1];};
+    scratch.order.resize(num_comps);
+    for (std::size_t comp = 0; comp < num_comps; comp++) scratch.order[comp] = comp;
+    std::sort(scratch.order.begin(), scratch.order.end(), [&](int a, int b)
+    {
+        if (lowest(a) != lowest(b)) return lowest(a) < lowest(b);
+        if (highest(a) != highest(b)) return highest(a) > highest(b);
+        return num_endpoints(a) < num_endpoints(b);
+    });
+
+    // The stack holds the components whose [lowest, highest] we're still inside
+    parents.assign(num_comps, top);
+    parent_spans.assign(num_comps, 0);
+    scratch.stack.clear();
+    for (int comp : scratch.order)
+    {
+        while (!scratch.stack.empty() && highest(scratch.stack.back()) < highest(comp)) scratch.stack.pop_back();
+        if (!scratch.stack.empty())
+        {
+            int const parent = scratch.stack.back();
+            auto const first = endpoints.begin() + endpoint_offsets[parent];
+            auto const last = endpoints.begin() + endpoint_offsets[parent + 1];
+            parents[comp] = parent;
+            parent_spans[comp] = std::upper_bound(first, last, lowest(comp)) - first - 1;
+        }
+        scratch.stack.push_back(comp);
+    }
+
+    // Group the children by parent, keeping them in sorted order
+    child_offsets.assign(num_comps + 2, 0);
+    for (int parent : parents) child_offsets[parent + 2]++;
+    for (std::size_t parent = 0; parent <= num_comps; parent++) child_offsets[parent + 1] += child_offsets[parent];
+    children_of.resize(num_comps);
+    scratch.last_seen.assign(child_offsets.begin(), child_offsets.end() - 1);
+    for (int comp : scratch.order) children_of[scratch.last_seen[parents[comp] + 1]++] = comp;
+}
+
+void ComponentTree::build(CrossingComponents const& comps)
+{
+    build(comps.get_num_vertices(), comps.size(), [&comps](auto add)
+    {
+        for (std::size_t comp = 0; comp < comps.size(); comp++)
+        {
+            for (Chord const& chord : comps[comp]) add(chord, comp);
+        }
+    });
+}
+
+void ComponentTree::build(std::vector<Hamiltonian> const& comps)
+{
+    build(comps.empty() ? 0 : comps.front().get_num_vertices(), comps.size(), [&comps](auto add)
+    {
+        for (std::size_t comp = 0; comp < comps.size(); comp++)
+        {
+            for (Chord const& chord : comps[comp].chords()) add(chord, comp);
+        }
+    });
+}
+
+ComponentTree::Children ComponentTree::children(int comp) const
+{
+    return {children_of.data() + child_offsets[comp + 1], children_of.data() + child_offsets[comp + 2]};
+}
+
+int ComponentTree::depth(std::size_t comp) const
+{
+    int ret = 0;
+    for (int parent = parents[comp]; parent != top; parent = parents[parent]) ret++;
+    return ret;
+}
+
+Span ComponentTree::get_span(std::size_t comp, std::size_t span) const
+{
+    std::size_t const next = span + 1 == num_endpoints(comp) ? 0 : span + 1;
+    return Span(endpoint(comp, span), endpoint(comp, next), num_vertices);
+}
+
+std::vector<Span> ComponentTree::spans(std::size_t comp) const
+{
+    std::vector<Span> ret;
+    ret.reserve(num_endpoints(comp));
+    for (std::size_t span = 0; span < num_endpoints(comp); span++) ret.push_back(get_span(comp, span));
+    return ret;
+}
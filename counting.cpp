@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "pancyclic.h"
+
+BigUnsigned::BigUnsigned(std::uint64_t value)
+{
+    for (; value; value >>= 32) limbs.push_back(static_cast<std::uint32_t>(value));
+}
+
+std::uint64_t BigUnsigned::to_u64() const
+{
+    if (!fits_u64()) throw std::overflow_error("BigUnsigned doesn't fit in 64 bits");
+    std::uint64_t value = 0;
+    for (std::size_t limb = limbs.size(); limb-- > 0;) value = (value << 32) | limbs[limb];
+    return value;
+}
+
+std::string BigUnsigned::to_string() const
+{
+    if (is_zero()) return "0";
+
+    // Peel off 9 decimal digits at a time
+    BigUnsigned rest = *this;
+    std::vector<std::uint32_t> groups;
+    while (!rest.is_zero()) groups.push_back(rest.divide(1000000000));
+
+    std::string ret = std::to_string(groups.back());
+    for (std::size_t group = groups.size() - 1; group-- > 0;)
+    {
+        std::string const digits = std::to_string(groups[group]);
+        ret.append(9 - digits.size(), '0');
+        ret += digits;
+    }
+    return ret;
+}
+
+BigUnsigned& BigUnsigned::operator+=(BigUnsigned const& other)
+{
+    if (other.limbs.size() > limbs.size()) limbs.resize(other.limbs.size(), 0);
+    std::uint64_t carry = 0;
+    for (std::size_t limb = 0; limb < limbs.size() && (carry || limb < other.limbs.size()); limb++)
+    {
+        carry += limbs[limb];
+        if (limb < other.limbs.size()) carry += other.limbs[limb];
+        limbs[limb] = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+    }
+    if (carry) limbs.push_back(static_cast<std::uint32_t>(carry));
+    return *this;
+}
+
+BigUnsigned& BigUnsigned::operator*=(std::uint32_t factor)
+{
+    std::uint64_t carry = 0;
+    for (auto& limb : limbs)
+    {
+        carry += static_cast<std::uint64_t>(limb) * factor;
+        limb = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+    }
+    if (carry) limbs.push_back(static_cast<std::uint32_t>(carry));
+    trim();
+    return *this;
+}
+
+std::uint32_t BigUnsigned::divide(std::uint32_t divisor)
+{
+    if (!divisor) throw std::domain_error("BigUnsigned divided by zero");
+    std::uint64_t rem = 0;
+    for (std::size_t limb = limbs.size(); limb-- > 0;)
+    {
+        std::uint64_t const current = (rem << 32) | limbs[limb];
+        limbs[limb] = static_cast<std::uint32_t>(current / divisor);
+        rem = current % divisor;
+    }
+    trim();
+    return static_cast<std::uint32_t>(rem);
+}
+
+bool operator<(BigUnsigned const& a, BigUnsigned const& b)
+{
+    if (a.limbs.size() != b.limbs.size()) return a.limbs.size() < b.limbs.size();
+    return std::lexicographical_compare(a.limbs.rbegin(), a.limbs.rend(), b.limbs.rbegin(), b.limbs.rend());
+}
+
+
+OrbitCounter::OrbitCounter(int nvert) : num_vertices(nvert)
+{
+    if (nvert < 3) throw std::invalid_argument("Hamiltonian cycles need at least 3 vertices");
+    unsigned long int const num_chords = Chord::max_num_chords(nvert);
+
+    // Cycle type of every group element on the chords, as sorted (length, how many cycles) pairs,
+    // along with how many elements have it
+    std::map<std::vector<std::pair<unsigned long int, unsigned long int>>, std::uint32_t> types;
+    std::vector<char> visited(num_chords);
+    std::vector<unsigned long int> cycles_of_length(num_chords + 1);
+    for (int element = 0; element < 2 * nvert; element++)
+    {
+        Dihedral const group_element(nvert, element);
+        std::fill(visited.begin(), visited.end(), false);
+        std::fill(cycles_of_length.begin(), cycles_of_length.end(), 0);
+        for (unsigned long int idx = 0; idx < num_chords; idx++)
+        {
+            if (visited[idx]) continue;
+            unsigned long int length = 0;
+            for (unsigned long int at = idx; !visited[at]; at = group_element.apply(Chord::from_index(at, nvert)).index())
+            {
+                visited[at] = true;
+                length++;
+            }
+            cycles_of_length[length]++;
+        }
+
+        std::vector<std::pair<unsigned long int, unsigned long int>> type;
+        for (unsigned long int length = 1; length <= num_chords; length++)
+        {
+            if (cycles_of_length[length]) type.emplace_back(length, cycles_of_length[length]);
+        }
+        types[type]++;
+    }
+
+    // Sum up prod (1 + x^length) over the elements, one cycle type at a time
+    std::vector<BigUnsigned> sum(num_chords + 1);
+    std::vector<BigUnsigned> product(num_chords + 1);
+    for (auto const& type : types)
+    {
+        // Start from the length with the most cycles, whose (1 + x^length)^cycles is just binomial coefficients
+        // (for the identity that's the whole answer), and multiply the rest in one factor at a time
+        auto const seed = std::max_element(type.first.begin(), type.first.end(),
+            [](std::pair<unsigned long int, unsigned long int> const& a, std::pair<unsigned long int, unsigned long int> const& b)
+            {return a.second < b.second;});
+        std::fill(product.begin(), product.end(), BigUnsigned());
+        product[0] = 1;
+        unsigned long int degree = 0;
+        if (seed != type.first.end())
+        {
+            BigUnsigned binomial = 1;
+            for (unsigned long int taken = 1; taken <= seed->second; taken++)
+            {
+                binomial *= seed->second - taken + 1;
+                binomial.divide(taken);
+                product[taken * seed->first] = binomial;
+            }
+            degree = seed->first * seed->second;
+        }
+        for (auto cycles = type.first.begin(); cycles != type.first.end(); ++cycles)
+        {
+            if (cycles == seed) continue;
+            unsigned long int const length = cycles->first;
+            for (unsigned long int cycle = 0; cycle < cycles->second; cycle++)
+            {
+                // Go from the top down so every coefficient is only added in once
+                degree += length;
+                for (unsigned long int power = degree; power >= length; power--) product[power] += product[power - length];
+            }
+        }
+        for (unsigned long int power = 0; power <= num_chords; power++)
+        {
+            product[power] *= type.second;
+            sum[power] += product[power];
+        }
+    }
+
+    counts.resize(num_chords + 1);
+    for (unsigned long int power = 0; power <= num_chords; power++)
+    {
+        counts[power] = sum[power];
+        if (counts[power].divide(2 * nvert))
+            throw std::logic_error("Burnside sum isn't divisible by the group order");
+    }
+}
+
+BigUnsigned OrbitCounter::count(int chords) const
+{
+    if (chords < 0 || static_cast<std::size_t>(chords) >= counts.size()) return BigUnsigned();
+    return counts[chords];
+}
+
+BigUnsigned OrbitCounter::count(int min_chords, int max_chords) const
+{
+    int const most = counts.size() - 1;
+    if (max_chords < 0 || max_chords > most) max_chords = most;
+    BigUnsigned ret;
+    for (int chords = std::max(min_chords, 0); chords <= max_chords; chords++) ret += counts[chords];
+    return ret;
+}
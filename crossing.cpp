@@ -0,0 +1,125 @@
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "pancyclic.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PANCYCLIC_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    using word_type = CrossingMatrix::word_type;
+    const unsigned int word_bits = CrossingMatrix::word_bits;
+
+    // The kernels want the endpoints as two flat arrays, padded out to whole words
+    // The padding chords are (-1, -1), which can't cross anything
+    struct Endpoints
+    {
+        std::vector<std::int32_t> starts;
+        std::vector<std::int32_t> ends;
+
+        Endpoints(std::vector<Chord> const& chords, unsigned int row_words) :
+            starts(row_words * word_bits, -1), ends(row_words * word_bits, -1)
+        {
+            for (std::size_t idx = 0; idx < chords.size(); idx++)
+            {
+                starts[idx] = chords[idx].get_start();
+                ends[idx] = chords[idx].get_end();
+            }
+        }
+    };
+
+    // Chords are stored with start < end, so crossing is just the intervals interleaving
+    // Shared endpoints never count, same as get_turning's degenerate cases
+    void fill_scalar(Endpoints const& ends, std::size_t num, unsigned int row_words, word_type* bits)
+    {
+        for (std::size_t i = 0; i < num; i++)
+        {
+            std::int32_t const si = ends.starts[i], ei = ends.ends[i];
+            word_type* row = bits + i * row_words;
+            for (std::size_t j = 0; j < num; j++)
+            {
+                std::int32_t const sj = ends.starts[j], ej = ends.ends[j];
+                bool const cross = ((si < sj) & (sj < ei) & (ei < ej)) | ((sj < si) & (si < ej) & (ej < ei));
+                row[j / word_bits] |= word_type(cross) << (j % word_bits);
+            }
+        }
+    }
+
+#ifdef PANCYCLIC_X86_KERNELS
+    __attribute__((target("avx2")))
+    void fill_avx2(Endpoints const& ends, std::size_t num, unsigned int row_words, word_type* bits)
+    {
+        for (std::size_t i = 0; i < num; i++)
+        {
+            __m256i const si = _mm256_set1_epi32(ends.starts[i]);
+            __m256i const ei = _mm256_set1_epi32(ends.ends[i]);
+            word_type* row = bits + i * row_words;
+            for (unsigned int word = 0; word < row_words; word++)
+            {
+                word_type acc = 0;
+                for (unsigned int lane = 0; lane < word_bits; lane += 8)
+                {
+                    std::size_t const j = word * word_bits + lane;
+                    __m256i const sj = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(&ends.starts[j]));
+                    __m256i const ej = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(&ends.ends[j]));
+                    // si < sj < ei < ej, or the other way around
+                    __m256i const fwd = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(sj, si), _mm256_cmpgt_epi32(ei, sj)), _mm256_cmpgt_epi32(ej, ei));
+                    __m256i const back = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(si, sj), _mm256_cmpgt_epi32(ej, si)), _mm256_cmpgt_epi32(ei, ej));
+                    unsigned int const mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(fwd, back)));
+                    acc |= word_type(mask) << lane;
+                }
+                row[word] = acc;
+            }
+        }
+    }
+#endif
+}
+
+
+bool CrossingMatrix::kernel_supported(Kernel kernel)
+{
+    switch (kernel)
+    {
+        case AUTO:
+        case SCALAR:
+            return true;
+#ifdef PANCYCLIC_X86_KERNELS
+        case AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+CrossingMatrix::CrossingMatrix(std::vector<Chord> const& chords, Kernel kernel) : num_chords(chords.size())
+{
+    row_words = num_chords / word_bits + (num_chords % word_bits ? 1 : 0);
+    bits.assign(num_chords * row_words, 0);
+    if (!num_chords) return;
+
+    if (kernel == AUTO)
+    {
+        kernel = kernel_supported(AVX2) ? AVX2 : SCALAR;
+    }
+    if (!kernel_supported(kernel)) throw std::invalid_argument("Crossing matrix kernel isn't supported on this CPU");
+
+    Endpoints const ends(chords, row_words);
+    switch (kernel)
+    {
+#ifdef PANCYCLIC_X86_KERNELS
+        case AVX2:
+            fill_avx2(ends, num_chords, row_words, bits.data());
+            break;
+#endif
+        default:
+            fill_scalar(ends, num_chords, row_words, bits.data());
+            break;
+    }
+}
+
+CrossingMatrix Chord::crossing_matrix(std::vector<Chord> const& chords, CrossingMatrix::Kernel kernel)
+{return CrossingMatrix(chords, kernel);}
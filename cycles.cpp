@@ -0,0 +1,322 @@
+#include <stdexcept>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+#include "pancyclic.h"
+
+namespace
+{
+    // Vertex sets and length sets are both single words, which is why the engine stops at 64 vertices
+    using mask_type = std::uint64_t;
+    const int max_vertices = 8 * sizeof(mask_type);
+
+    // Lengths go from 1 to 64, so length L lives in bit L-1
+    mask_type length_bit(int length) {return mask_type(1) << (length - 1);}
+    int longest(mask_type lengths) {return lengths ? max_vertices - __builtin_clzll(lengths) : 0;}
+
+    // Finds which of the wanted cycle lengths exist, crossing them off as it goes
+    class CycleSearch
+    {
+        private:
+            int num_vertices;
+            mask_type adj[max_vertices];
+            mask_type wanted;
+            mask_type found;
+
+            // State for the current search, which only looks at cycles whose smallest vertex is start
+            int start;
+            mask_type allowed;
+            int dist[max_vertices];
+
+            void record(int length)
+            {
+                found |= length_bit(length);
+                wanted &= ~length_bit(length);
+            }
+
+            void record_chord_cycles(std::vector<Chord> const& chords);
+            void record_chord_pair_cycles(std::vector<Chord> const& chords);
+            void compute_dist();
+            void dfs(int cur, mask_type visited, int len);
+
+        public:
+            CycleSearch(Hamiltonian const& graph, std::vector<Chord> const& chords, mask_type wanted_lengths);
+
+            mask_type run(std::vector<Chord> const& chords);
+    };
+
+    CycleSearch::CycleSearch(Hamiltonian const& graph, std::vector<Chord> const& chords, mask_type wanted_lengths) :
+        num_vertices(graph.get_num_vertices()), wanted(wanted_lengths), found(0)
+    {
+        for (int vert = 0; vert < num_vertices; vert++)
+        {
+            int const next = (vert + 1) % num_vertices;
+            adj[vert] = (mask_type(1) << next) | (mask_type(1) << ((vert + num_vertices - 1) % num_vertices));
+        }
+        for (Chord const& chord : chords)
+        {
+            adj[chord.get_start()] |= mask_type(1) << chord.get_end();
+            adj[chord.get_end()] |= mask_type(1) << chord.get_start();
+        }
+    }
+
+    void CycleSearch::record_chord_cycles(std::vector<Chord> const& chords)
+    {
+        // A chord plus either arc of the cycle between its endpoints
+        for (Chord const& chord : chords)
+        {
+            int const len = chord.get_end() - chord.get_start();
+            if (wanted & length_bit(len + 1)) record(len + 1);
+            if (wanted & length_bit(num_vertices - len + 1)) record(num_vertices - len + 1);
+        }
+    }
+
+    mask_type chord_pair_lengths(Chord const& a, Chord const& b, int num_vertices)
+    {
+        // Two chords plus the two arcs joining them, for however the chords sit relative to each other
+        // a has to start no later than b
+        int const s1 = a.get_start(), e1 = a.get_end();
+        int const s2 = b.get_start(), e2 = b.get_end();
+        if (e1 <= s2)
+        {
+            // Side by side: s1 - e1 .. s2 - e2 .. s1
+            return length_bit((s2 - e1 + 1) + (num_vertices - e2 + s1 + 1));
+        }
+        else if (e2 <= e1)
+        {
+            // Nested: s1 .. s2 - e2 .. e1 - s1
+            return length_bit((s2 - s1 + 1) + (e1 - e2 + 1));
+        }
+        else if (s1 == s2)
+        {
+            // Same start, so a is nested in b: s1 - e1 .. e2 - s1
+            return length_bit(1 + (e2 - e1 + 1));
+        }
+        else
+        {
+            // Crossing, which can be walked two ways
+            return length_bit((e1 - s2 + 1) + (num_vertices - e2 + s1 + 1)) | length_bit((s2 - s1 + 1) + (e2 - e1 + 1));
+        }
+    }
+
+    void CycleSearch::record_chord_pair_cycles(std::vector<Chord> const& chords)
+    {
+        // Chords are sorted by start, so a.start <= b.start
+        for (auto a = chords.begin(); a != chords.end() && wanted; ++a)
+        {
+            for (auto b = std::next(a); b != chords.end() && wanted; ++b)
+            {
+                mask_type const lengths = chord_pair_lengths(*a, *b, num_vertices) & wanted;
+                found |= lengths;
+                wanted &= ~lengths;
+            }
+        }
+    }
+
+    void CycleSearch::compute_dist()
+    {
+        // BFS back to start inside the allowed vertices, which lower bounds how long any cycle through a vertex is
+        for (int vert = 0; vert < num_vertices; vert++) dist[vert] = num_vertices + 1;
+        dist[start] = 0;
+        mask_type frontier = mask_type(1) << start;
+        mask_type seen = frontier;
+        for (int d = 1; frontier; d++)
+        {
+            mask_type next = 0;
+            for (mask_type bits = frontier; bits; bits &= bits - 1) next |= adj[__builtin_ctzll(bits)];
+            next &= allowed & ~seen;
+            for (mask_type bits = next; bits; bits &= bits - 1) dist[__builtin_ctzll(bits)] = d;
+            seen |= next;
+            frontier = next;
+        }
+    }
+
+    void CycleSearch::dfs(int cur, mask_type visited, int len)
+    {
+        // len is the number of vertices on the path from start to cur
+        if (len >= 3 && (adj[cur] >> start & 1) && (wanted & length_bit(len))) record(len);
+
+        for (mask_type next = adj[cur] & allowed & ~visited; next && wanted; next &= next - 1)
+        {
+            int const vert = __builtin_ctzll(next);
+            // Any cycle through vert has at least len + dist[vert] vertices
+            if (len + dist[vert] > longest(wanted)) continue;
+            dfs(vert, visited | (mask_type(1) << vert), len + 1);
+        }
+    }
+
+    mask_type CycleSearch::run(std::vector<Chord> const& chords)
+    {
+        // The Hamiltonian cycle is always there
+        if (wanted & length_bit(num_vertices)) record(num_vertices);
+
+        record_chord_cycles(chords);
+        record_chord_pair_cycles(chords);
+
+        // Everything else is found by looking for cycles starting (and ending) at their smallest vertex
+        for (start = 0; start < num_vertices - 2 && wanted; start++)
+        {
+            allowed = ~mask_type(0) << (start + 1);
+            if (num_vertices < max_vertices) allowed &= (mask_type(1) << num_vertices) - 1;
+            compute_dist();
+            dfs(start, mask_type(1) << start, 1);
+        }
+        return found;
+    }
+
+    mask_type cycle_lengths(Hamiltonian const& graph, mask_type wanted)
+    {
+        if (graph.get_num_vertices() > max_vertices)
+            throw std::invalid_argument("Cycle lengths are only supported for up to 64 vertices");
+        if (graph.get_num_vertices() < 3) return 0;
+
+        std::vector<Chord> const chords = graph.chord_vector();
+
+        CycleSearch search(graph, chords, wanted);
+        return search.run(chords);
+    }
+
+    // Finds which of the wanted lengths the cycles through a new chord (start, end) have, i.e. the paths from end
+    // back to start that don't use the chord, given the adjacency from before it was added
+    class ChordCycleSearch
+    {
+        private:
+            std::uint64_t const* adj;
+            int target;
+            mask_type wanted;
+            mask_type found;
+            int dist[max_vertices];
+
+            void dfs(int cur, mask_type visited, int len)
+            {
+                // len is the number of vertices on the path from end to cur, so closing it up adds target
+                if ((adj[cur] >> target & 1) && (wanted & length_bit(len + 1)))
+                {
+                    found |= length_bit(len + 1);
+                    wanted &= ~length_bit(len + 1);
+                }
+
+                for (mask_type next = adj[cur] & ~visited; next && wanted; next &= next - 1)
+                {
+                    int const vert = __builtin_ctzll(next);
+                    // Any path through vert closes up into a cycle of at least len + 1 + dist[vert] vertices
+                    if (len + 1 + dist[vert] > longest(wanted)) continue;
+                    dfs(vert, visited | (mask_type(1) << vert), len + 1);
+                }
+            }
+
+        public:
+            ChordCycleSearch(std::uint64_t const* adjacency, int num_vertices, int target, mask_type wanted_lengths) :
+                adj(adjacency), target(target), wanted(wanted_lengths), found(0)
+            {
+                // BFS out from target, for the distance back to it from everywhere
+                for (int vert = 0; vert < num_vertices; vert++) dist[vert] = num_vertices + 1;
+                dist[target] = 0;
+                mask_type frontier = mask_type(1) << target;
+                mask_type seen = frontier;
+                for (int d = 1; frontier; d++)
+                {
+                    mask_type next = 0;
+                    for (mask_type bits = frontier; bits; bits &= bits - 1) next |= adj[__builtin_ctzll(bits)];
+                    next &= ~seen;
+                    for (mask_type bits = next; bits; bits &= bits - 1) dist[__builtin_ctzll(bits)] = d;
+                    seen |= next;
+                    frontier = next;
+                }
+            }
+
+            mask_type run(int from)
+            {
+                // The target only ever ends a path, so it starts out visited
+                if (wanted) dfs(from, (mask_type(1) << from) | (mask_type(1) << target), 1);
+                return found;
+            }
+    };
+}
+
+
+boost::dynamic_bitset<> Hamiltonian::cycle_length_spectrum() const
+{
+    mask_type const found = get_cycle_lengths();
+    boost::dynamic_bitset<> spectrum(num_vertices + 1);
+    for (int length = 3; length <= num_vertices; length++) spectrum[length] = (found & length_bit(length)) != 0;
+    return spectrum;
+}
+
+bool Hamiltonian::is_pancyclic() const
+{
+    mask_type const wanted = all_cycle_lengths(num_vertices);
+    if (cycle_tracker.enabled) return cycle_tracker.lengths == wanted;
+    return cycle_lengths(*this, wanted) == wanted;
+}
+
+std::uint64_t Hamiltonian::get_cycle_lengths() const
+{
+    if (cycle_tracker.enabled) return cycle_tracker.lengths;
+    return cycle_lengths(*this, all_cycle_lengths(num_vertices));
+}
+
+std::uint64_t Hamiltonian::all_cycle_lengths(int nvert)
+{
+    if (nvert < 3) return 0;
+    mask_type upto = nvert == max_vertices ? ~mask_type(0) : length_bit(nvert + 1) - 1;
+    return upto & ~(length_bit(3) - 1);
+}
+
+void Hamiltonian::track_cycle_lengths(bool track)
+{
+    if (track == cycle_tracker.enabled) return;
+    if (!track)
+    {
+        cycle_tracker = CycleTracker();
+        return;
+    }
+    if (num_vertices > max_vertices) throw std::invalid_argument("Cycle lengths are only supported for up to 64 vertices");
+
+    cycle_tracker.enabled = true;
+    rebuild_cycle_tracker();
+}
+
+void Hamiltonian::rebuild_cycle_tracker(bool same_lengths)
+{
+    cycle_tracker.undo.clear();
+    cycle_tracker.adjacency.assign(num_vertices, 0);
+    for (int vert = 0; vert < num_vertices; vert++)
+    {
+        cycle_tracker.adjacency[vert] = (mask_type(1) << (vert + 1) % num_vertices) |
+            (mask_type(1) << (vert + num_vertices - 1) % num_vertices);
+    }
+    for (Chord chord : chords())
+    {
+        cycle_tracker.adjacency[chord.get_start()] |= mask_type(1) << chord.get_end();
+        cycle_tracker.adjacency[chord.get_end()] |= mask_type(1) << chord.get_start();
+    }
+    if (!same_lengths) cycle_tracker.lengths = cycle_lengths(*this, all_cycle_lengths(num_vertices));
+}
+
+void Hamiltonian::track_cycles(unsigned long int idx, int start, int end)
+{
+    CycleTracker& cycles = cycle_tracker;
+    cycles.undo.emplace_back(idx, cycles.lengths);
+    mask_type wanted = all_cycle_lengths(num_vertices) & ~cycles.lengths;
+
+    // The two cycles round either arc, and the ones using one other chord, have closed forms
+    Chord const chord(start, end, num_vertices);
+    wanted &= ~(length_bit(end - start + 1) | length_bit(num_vertices - (end - start) + 1));
+    for (int vert = 0; vert < num_vertices && wanted; vert++)
+    {
+        // Chords come up once from each end, so only take them from their start
+        for (mask_type others = cycles.adjacency[vert] & (~mask_type(0) << vert << 1); others && wanted; others &= others - 1)
+        {
+            int const other_end = __builtin_ctzll(others);
+            if (other_end == vert + 1 || (vert == 0 && other_end == num_vertices - 1)) continue;
+            Chord const other(vert, other_end, num_vertices);
+            wanted &= ~(vert <= start ? chord_pair_lengths(other, chord, num_vertices) : chord_pair_lengths(chord, other, num_vertices));
+        }
+    }
+
+    // Anything else needs a search, which runs before the chord goes into the adjacency so paths can't use it
+    if (wanted) wanted &= ~ChordCycleSearch(cycles.adjacency.data(), num_vertices, start, wanted).run(end);
+    cycles.lengths = (all_cycle_lengths(num_vertices) & ~wanted);
+    cycles.adjacency[start] |= mask_type(1) << end;
+    cycles.adjacency[end] |= mask_type(1) << start;
+}
@@ -0,0 +1,72 @@
+#include <vector>
+#include "pancyclic.h"
+
+ChordEnumerator::ChordEnumerator(int nvert, int min_chords, int max_chords) :
+    num_vertices(nvert), min_chords(min_chords), canon(&Canonicalizer::for_vertices(nvert))
+{
+    int const most = Chord::max_num_chords(nvert);
+    this->max_chords = (max_chords < 0 || max_chords > most) ? most : max_chords;
+
+    all_chords.reserve(most);
+    for (int start = 0; start < num_vertices - 2; start++)
+    {
+        for (int end = start+2; end < num_vertices - (start ? 0 : 1); end++)
+            all_chords.push_back(Chord(start, end, num_vertices));
+    }
+}
+
+
+ChordEnumerator::iterator::iterator(ChordEnumerator const* theGen) : gen(theGen), graph(theGen->num_vertices), done(false)
+{
+    // The empty graph is the root, but it might be filtered out
+    if (graph.get_num_chords() < gen->min_chords) ++(*this);
+}
+
+bool ChordEnumerator::iterator::push_child(unsigned long int from)
+{
+    for (unsigned long int idx = from; idx < lowest(); idx++)
+    {
+        graph.add_chord(gen->all_chords[idx]);
+        if (gen->canon->is_canonical(graph))
+        {
+            added.push_back(idx);
+            return true;
+        }
+        graph.remove_chord(gen->all_chords[idx]);
+    }
+    return false;
+}
+
+void ChordEnumerator::iterator::step()
+{
+    // Same pruning as visit_subtree: children can only add chords below the one they add
+    auto first_useful = [this](unsigned long int from)
+    {
+        long int first = static_cast<long int>(gen->min_chords) - graph.get_num_chords() - 1;
+        return first > static_cast<long int>(from) ? static_cast<unsigned long int>(first) : from;
+    };
+
+    // Preorder: go down if we can, otherwise back up until there's a next sibling
+    if (graph.get_num_chords() < gen->max_chords && push_child(first_useful(0))) return;
+    while (!added.empty())
+    {
+        unsigned long int const last = added.back();
+        added.pop_back();
+        graph.remove_chord(gen->all_chords[last]);
+        if (push_child(first_useful(last + 1))) return;
+    }
+    done = true;
+}
+
+ChordEnumerator::iterator& ChordEnumerator::iterator::operator++()
+{
+    do step(); while (!done && graph.get_num_chords() < gen->min_chords);
+    return *this;
+}
+
+ChordEnumerator::iterator ChordEnumerator::iterator::operator++(int)
+{
+    iterator tmp = *this;
+    ++(*this);
+    return tmp;
+}
@@ -0,0 +1,95 @@
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include "pancyclic.h"
+
+using namespace std;
+
+// Runs one shard of a big enumeration, or merges the finished shards into one catalog
+//   pancyclic_enumerate run <n> --shard i/N [options]
+//   pancyclic_enumerate merge <n> --shards N --out FILE [options]
+// Options have to be the same for every run and the merge:
+//   --dir D                 where the shard files go (default .)
+//   --prefix-chords K       chords in the subtrees that are dealt out to shards (default 3)
+//   --min-chords A, --max-chords B
+// Only for run:
+//   --checkpoint-seconds S  how often to checkpoint (default 60)
+//   --time-limit S          stop (resumably) after this long, exiting with 2
+
+namespace
+{
+    int usage(char const* program)
+    {
+        cerr << "Usage: " << program << " run <n> --shard i/N [--dir D] [--prefix-chords K] [--min-chords A] [--max-chords B]"
+            " [--checkpoint-seconds S] [--time-limit S]" << endl;
+        cerr << "       " << program << " merge <n> --shards N --out FILE [--dir D] [--prefix-chords K] [--min-chords A] [--max-chords B]"
+            << endl;
+        return 1;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) return usage(argv[0]);
+    string const command = argv[1];
+    if (command != "run" && command != "merge") return usage(argv[0]);
+
+    ShardedEnumeration::Settings settings;
+    settings.num_vertices = atoi(argv[2]);
+    int shard = -1;
+    string dir = ".", out;
+    double checkpoint_seconds = 60, time_limit = 0;
+    for (int arg = 3; arg < argc; arg++)
+    {
+        char const* const value = arg + 1 < argc ? argv[arg + 1] : nullptr;
+        if (!value) return usage(argv[0]);
+        if (!strcmp(argv[arg], "--shard"))
+        {
+            char const* const slash = strchr(value, '/');
+            if (!slash) return usage(argv[0]);
+            shard = atoi(value);
+            settings.num_shards = atoi(slash + 1);
+        }
+        else if (!strcmp(argv[arg], "--shards")) settings.num_shards = atoi(value);
+        else if (!strcmp(argv[arg], "--dir")) dir = value;
+        else if (!strcmp(argv[arg], "--out")) out = value;
+        else if (!strcmp(argv[arg], "--prefix-chords")) settings.prefix_chords = atoi(value);
+        else if (!strcmp(argv[arg], "--min-chords")) settings.min_chords = atoi(value);
+        else if (!strcmp(argv[arg], "--max-chords")) settings.max_chords = atoi(value);
+        else if (!strcmp(argv[arg], "--checkpoint-seconds")) checkpoint_seconds = atof(value);
+        else if (!strcmp(argv[arg], "--time-limit")) time_limit = atof(value);
+        else return usage(argv[0]);
+        arg++;
+    }
+    if (command == "run" ? shard < 0 : out.empty()) return usage(argv[0]);
+
+    try
+    {
+        ShardedEnumeration const enumeration(dir, settings);
+        if (command == "run")
+        {
+            if (!enumeration.run(shard, checkpoint_seconds, time_limit))
+            {
+                cerr << "Shard " << shard << " stopped at the time limit, run it again to carry on" << endl;
+                return 2;
+            }
+            cout << "Shard " << shard << " done: " << enumeration.path(shard, "catalog") << endl;
+        }
+        else
+        {
+            ShardedEnumeration::MergeReport const report = enumeration.merge(out);
+            cout << "Merged " << report.num_graphs << " graphs into " << out << endl;
+            for (size_t idx = 0; idx < report.shard_graphs.size(); idx++)
+                cout << "\tshard " << idx << ": " << report.shard_graphs[idx] << endl;
+        }
+    }
+    catch (exception const& error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
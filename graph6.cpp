@@ -0,0 +1,387 @@
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "pancyclic.h"
+
+// graph6 and sparse6 are described in formats.txt, which comes with nauty
+// Both are printable bytes 63 .. 126, each carrying 6 bits, most significant bit first
+
+namespace
+{
+    const int bias = 63;
+
+    void write_size(std::string& out, unsigned long int n)
+    {
+        if (n <= 62)
+        {
+            out += static_cast<char>(n + bias);
+            return;
+        }
+        int groups = 3;
+        out += static_cast<char>(126);
+        if (n > 258047)
+        {
+            out += static_cast<char>(126);
+            groups = 6;
+        }
+        for (int group = groups; group-- > 0;) out += static_cast<char>(((n >> (6 * group)) & 63) + bias);
+    }
+
+    // Reads N(n) and returns where the rest starts
+    char const* read_size(char const* first, char const* last, unsigned long int& n)
+    {
+        int groups = 1;
+        if (first < last && *first == 126)
+        {
+            first++;
+            groups = 3;
+            if (first < last && *first == 126)
+            {
+                first++;
+                groups = 6;
+            }
+        }
+        if (last - first < groups) throw std::invalid_argument("Graph is cut off in its number of vertices");
+        n = 0;
+        for (int group = 0; group < groups; group++, first++)
+        {
+            if (*first < bias || *first > 126) throw std::invalid_argument("Graph has a character outside 63 .. 126");
+            n = (n << 6) | (*first - bias);
+        }
+        return first;
+    }
+
+    // Packs bits 6 at a time, most significant first
+    class BitWriter
+    {
+        private:
+            std::string& out;
+            std::uint64_t pending;
+            int num_pending;
+
+        public:
+            BitWriter(std::string& out) : out(out), pending(0), num_pending(0) {}
+
+            // bits can be anything up to 58
+            void put(std::uint64_t value, int bits)
+            {
+                pending = (pending << bits) | value;
+                num_pending += bits;
+                while (num_pending >= 6)
+                {
+                    num_pending -= 6;
+                    out += static_cast<char>(((pending >> num_pending) & 63) + bias);
+                }
+            }
+
+            // Pads the last character out with fill bits
+            void finish(bool fill)
+            {
+                int const padding = num_pending ? 6 - num_pending : 0;
+                put(fill ? (std::uint64_t(1) << padding) - 1 : 0, padding);
+            }
+    };
+
+    class BitReader
+    {
+        private:
+            char const* pos;
+            char const* last;
+            std::uint64_t current;
+            int num_left;
+
+        public:
+            BitReader(char const* first, char const* last) : pos(first), last(last), current(0), num_left(0) {}
+
+            long int bits_left() const {return num_left + 6 * (last - pos);}
+
+            // Check bits_left() first
+            std::uint64_t get(int bits)
+            {
+                while (num_left < bits)
+                {
+                    if (*pos < bias || *pos > 126) throw std::invalid_argument("Graph has a character outside 63 .. 126");
+                    current = (current << 6) | (*pos++ - bias);
+                    num_left += 6;
+                }
+                num_left -= bits;
+                return (current >> num_left) & ((std::uint64_t(1) << bits) - 1);
+            }
+    };
+
+    // Both formats go through the upper triangle a column at a time: (0,1), (0,2), (1,2), (0,3), ...
+    // Entry p of this is the chord index of the p'th pair in that order, or cycle_edge for edges of the cycle
+    // It's only rebuilt when n changes, so converting a stream of same-sized graphs never rebuilds it
+    const std::int32_t cycle_edge = -1;
+
+    std::vector<std::int32_t> const& column_order(int n)
+    {
+        thread_local std::vector<std::int32_t> order;
+        thread_local int order_vertices = 0;
+        if (order_vertices != n)
+        {
+            order.clear();
+            for (int col = 1; col < n; col++)
+            {
+                for (int row = 0; row < col; row++)
+                {
+                    bool const is_cycle_edge = col == row + 1 || (row == 0 && col == n - 1);
+                    order.push_back(is_cycle_edge ? cycle_edge : static_cast<std::int32_t>(Chord::index(row, col, n)));
+                }
+            }
+            order_vertices = n;
+        }
+        return order;
+    }
+
+    // Which cycle edges a sparse6 graph has mentioned, since they can come up more than once there
+    // Edge i is (i, i+1), and edge n-1 is (0, n-1)
+    std::vector<char>& seen_cycle_edges(int n)
+    {
+        thread_local std::vector<char> seen;
+        seen.assign(n, false);
+        return seen;
+    }
+
+    void start_parse(unsigned long int n, Hamiltonian& out)
+    {
+        if (n < 3) throw std::invalid_argument("Graph needs at least 3 vertices to have a Hamiltonian cycle");
+        // The 6 group size goes up to 2^36, so check it before anything gets sized by it
+        if (n > static_cast<unsigned long int>(Chord::max_vertices))
+            throw std::invalid_argument("Graph has more than " + std::to_string(Chord::max_vertices) + " vertices");
+        if (out.get_num_vertices() == static_cast<int>(n)) out.clear();
+        else
+        {
+            // A new graph starts with tracking off, so carry over whatever the caller had on
+            bool const components = out.tracking_crossing_components();
+            bool const cycles = out.tracking_cycle_lengths();
+            out = Hamiltonian(n);
+            out.track_crossing_components(components);
+            out.track_cycle_lengths(cycles);
+        }
+    }
+
+    void missing_cycle_edge() {throw std::invalid_argument("Graph doesn't contain the Hamiltonian cycle 0, 1, ..., n-1");}
+}
+
+
+void Hamiltonian::to_graph6(std::string& out) const
+{
+    PANCYCLIC_TIME(ENCODE);
+    write_size(out, num_vertices);
+
+    auto const& order = column_order(num_vertices);
+    std::size_t const num_pairs = order.size();
+    for (std::size_t pair = 0; pair < num_pairs; pair += 6)
+    {
+        unsigned int bits = 0;
+        for (std::size_t bit = pair; bit < pair + 6; bit++)
+        {
+            bits <<= 1;
+            if (bit < num_pairs) bits |= order[bit] == cycle_edge || has_chord_bit(order[bit]);
+        }
+        out += static_cast<char>(bits + bias);
+    }
+}
+
+void Hamiltonian::to_sparse6(std::string& out) const
+{
+    PANCYCLIC_TIME(ENCODE);
+    out += ':';
+    write_size(out, num_vertices);
+
+    // Edges go out sorted by their bigger end, then their smaller one, which is the same column order as graph6
+    // Each one is a flag saying whether to move on to the next vertex and k bits of vertex number
+    int const k = 64 - __builtin_clzll(num_vertices - 1);
+    BitWriter bits(out);
+    int cur = 0;
+    int row = 0, col = 1;
+    for (std::int32_t const idx : column_order(num_vertices))
+    {
+        if (idx == cycle_edge || has_chord_bit(idx))
+        {
+            if (col == cur) bits.put(0, 1);
+            else if (col == cur + 1) bits.put(1, 1);
+            else
+            {
+                bits.put(1, 1);
+                bits.put(col, k);
+                bits.put(0, 1);
+            }
+            bits.put(row, k);
+            cur = col;
+        }
+        if (++row == col)
+        {
+            row = 0;
+            col++;
+        }
+    }
+    // formats.txt wants a 0 before the padding in one corner case where vertex n-1 has no edges,
+    // but here it always has the cycle edge back to 0
+    bits.finish(true);
+}
+
+std::string Hamiltonian::to_graph6() const
+{
+    std::string out;
+    to_graph6(out);
+    return out;
+}
+
+std::string Hamiltonian::to_sparse6() const
+{
+    std::string out;
+    to_sparse6(out);
+    return out;
+}
+
+void Hamiltonian::from_graph6(char const* first, char const* last, Hamiltonian& out)
+{
+    PANCYCLIC_TIME(DECODE);
+    if (last - first >= 10 && std::string::traits_type::compare(first, ">>graph6<<", 10) == 0) first += 10;
+    unsigned long int n;
+    first = read_size(first, last, n);
+    // This checks n too, so it goes before n is used for anything
+    start_parse(n, out);
+    unsigned long int const num_pairs = n * (n - 1) / 2;
+    if (static_cast<unsigned long int>(last - first) != (num_pairs + 5) / 6)
+        throw std::invalid_argument("graph6 graph is the wrong length for its number of vertices");
+
+    auto const& order = column_order(n);
+    // Every pair comes up once, so counting the cycle edges is enough to know they're all there
+    unsigned long int cycle_edges = 0;
+    for (unsigned long int pos = 0; first + pos < last; pos++)
+    {
+        int const value = first[pos] - bias;
+        if (value < 0 || value > 63) throw std::invalid_argument("Graph has a character outside 63 .. 126");
+        for (unsigned int bits = value; bits; bits &= bits - 1)
+        {
+            unsigned long int const pair = 6 * pos + 5 - __builtin_ctz(bits);
+            if (pair >= num_pairs) throw std::invalid_argument("graph6 graph has padding bits set");
+            if (order[pair] == cycle_edge) cycle_edges++;
+            else out.chord_bits[order[pair] / word_bits] |= word_type(1) << (order[pair] % word_bits);
+        }
+    }
+    if (cycle_edges != n) missing_cycle_edge();
+
+    for (word_type word : out.chord_bits) out.num_chords += __builtin_popcountll(word);
+    if (out.tracker.enabled) out.rebuild_tracker();
+    if (out.cycle_tracker.enabled) out.rebuild_cycle_tracker();
+}
+
+void Hamiltonian::from_sparse6(char const* first, char const* last, Hamiltonian& out)
+{
+    PANCYCLIC_TIME(DECODE);
+    if (last - first >= 11 && std::string::traits_type::compare(first, ">>sparse6<<", 11) == 0) first += 11;
+    if (first == last || *first != ':') throw std::invalid_argument("sparse6 graph doesn't start with ':'");
+    unsigned long int n;
+    first = read_size(first + 1, last, n);
+
+    start_parse(n, out);
+    std::vector<char>& seen = seen_cycle_edges(n);
+    BitReader bits(first, last);
+    int const k = 64 - __builtin_clzll(n - 1);
+    unsigned long int cur = 0;
+    while (bits.bits_left() >= 1 + k)
+    {
+        if (bits.get(1)) cur++;
+        unsigned long int const x = bits.get(k);
+        if (cur >= n) break;
+        if (x > cur) cur = x;
+        else if (x == cur) throw std::invalid_argument("sparse6 graph has a loop");
+        else if (cur == x + 1) seen[x] = true;
+        else if (x == 0 && cur == n - 1) seen[n - 1] = true;
+        else
+        {
+            auto const idx = Chord::index(x, cur, n);
+            out.chord_bits[idx / word_bits] |= word_type(1) << (idx % word_bits);
+        }
+    }
+    for (char edge : seen) if (!edge) missing_cycle_edge();
+
+    for (word_type word : out.chord_bits) out.num_chords += __builtin_popcountll(word);
+    if (out.tracker.enabled) out.rebuild_tracker();
+    if (out.cycle_tracker.enabled) out.rebuild_cycle_tracker();
+}
+
+Hamiltonian Hamiltonian::from_graph6(std::string const& text)
+{
+    Hamiltonian ret;
+    from_graph6(text.data(), text.data() + text.size(), ret);
+    return ret;
+}
+
+Hamiltonian Hamiltonian::from_sparse6(std::string const& text)
+{
+    Hamiltonian ret;
+    from_sparse6(text.data(), text.data() + text.size(), ret);
+    return ret;
+}
+
+
+unsigned long long int convert_graphs(std::istream& in, std::ostream& out, GraphFormat format, bool canonical)
+{
+    // Output is collected and written in big blocks
+    const std::size_t flush_size = 1 << 16;
+
+    std::string line;
+    std::string text;
+    Hamiltonian graph;
+    unsigned long long int count = 0;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        char const* first = line.data();
+        char const* last = first + line.size();
+        if (line.find_first_not_of("01") == std::string::npos)
+        {
+            // Graph number digits, which only fit one number of vertices
+            int n = 3;
+            while (Chord::max_num_chords(n) < line.size()) n++;
+            if (Chord::max_num_chords(n) != line.size())
+                throw std::invalid_argument("Graph number digits are the wrong length for any number of vertices");
+            if (graph.get_num_vertices() != n) graph = Hamiltonian(n);
+            else graph.clear();
+            for (unsigned long int idx = 0; idx < line.size(); idx++)
+            {
+                if (line[idx] == '1') graph.add_chord(Chord::from_index(idx, n));
+            }
+        }
+        else if (*first == ':' || line.compare(0, 11, ">>sparse6<<") == 0) Hamiltonian::from_sparse6(first, last, graph);
+        else Hamiltonian::from_graph6(first, last, graph);
+
+        if (canonical) graph.canonicalize();
+        switch (format)
+        {
+            case GRAPH6:
+                graph.to_graph6(text);
+                break;
+            case SPARSE6:
+                graph.to_sparse6(text);
+                break;
+            case GRAPH_NUM_DIGS:
+            {
+                auto const base = text.size();
+                text.append(Chord::max_num_chords(graph.get_num_vertices()), '0');
+                for (Chord const& chord : graph.chords()) text[base + chord.index()] = '1';
+                break;
+            }
+        }
+        text += '\n';
+        count++;
+
+        if (text.size() >= flush_size)
+        {
+            out.write(text.data(), text.size());
+            text.clear();
+        }
+    }
+    out.write(text.data(), text.size());
+    return count;
+}
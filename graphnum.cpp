@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "pancyclic.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PANCYCLIC_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    using word_type = GraphNumber::word_type;
+
+    // Index of the highest word where a and b differ, plus one, or 0 if they're equal
+    // Comparisons only care about the top differing word, so everything is scanned from the top down
+    unsigned int highest_difference_scalar(word_type const* a, word_type const* b, unsigned int count)
+    {
+        for (unsigned int word = count; word > 0; word--)
+        {
+            if (a[word - 1] != b[word - 1]) return word;
+        }
+        return 0;
+    }
+
+#ifdef PANCYCLIC_X86_KERNELS
+    __attribute__((target("avx2")))
+    unsigned int highest_difference_avx2(word_type const* a, word_type const* b, unsigned int count)
+    {
+        unsigned int word = count;
+        for (; word >= 4; word -= 4)
+        {
+            __m256i const wa = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + word - 4));
+            __m256i const wb = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + word - 4));
+            // One bit per word, set where they're equal
+            unsigned int const differ = ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(wa, wb))) & 0xF;
+            if (differ) return word - 4 + (32 - __builtin_clz(differ));
+        }
+        return highest_difference_scalar(a, b, word);
+    }
+#endif
+
+    using difference_kernel = unsigned int (*)(word_type const*, word_type const*, unsigned int);
+
+    difference_kernel pick_kernel()
+    {
+#ifdef PANCYCLIC_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return highest_difference_avx2;
+#endif
+        return highest_difference_scalar;
+    }
+
+    unsigned int highest_difference(word_type const* a, word_type const* b, unsigned int count)
+    {
+        // Most graph numbers are a word or two, where the call through the pointer costs more than it saves
+        if (count <= 2) return highest_difference_scalar(a, b, count);
+        static difference_kernel const kernel = pick_kernel();
+        return kernel(a, b, count);
+    }
+
+    // splitmix64's finalizer, which is a bijection, so distinct words never collide on their own
+    std::uint64_t mix(std::uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+}
+
+
+GraphNumber::GraphNumber(unsigned int words) : num_words(words), inline_storage{}
+{
+    if (num_words > inline_words) heap_storage.assign(num_words, 0);
+}
+
+GraphNumber::GraphNumber(word_type const* words, unsigned int count) : GraphNumber(count)
+{
+    std::copy(words, words + count, data());
+}
+
+GraphNumber GraphNumber::for_vertices(int nvert)
+{
+    auto const max_num_chords = Chord::max_num_chords(nvert);
+    return GraphNumber(max_num_chords / word_bits + (max_num_chords % word_bits ? 1 : 0));
+}
+
+unsigned long int GraphNumber::popcount() const
+{
+    unsigned long int count = 0;
+    for (unsigned int word = 0; word < num_words; word++) count += __builtin_popcountll(data()[word]);
+    return count;
+}
+
+std::size_t GraphNumber::hash() const {return hash(data(), num_words);}
+
+std::size_t GraphNumber::hash(word_type const* words, unsigned int count)
+{
+    // Leading zero words are skipped, so numbers that compare equal hash the same whatever their length
+    unsigned int top = count;
+    while (top > 0 && !words[top - 1]) top--;
+
+    std::uint64_t h = mix(top);
+    for (unsigned int word = 0; word < top; word++) h = mix(h ^ (words[word] + 0x9e3779b97f4a7c15ULL * (word + 1)));
+    return static_cast<std::size_t>(h);
+}
+
+int GraphNumber::compare(GraphNumber const& a, GraphNumber const& b)
+{
+    word_type const* wa = a.data();
+    word_type const* wb = b.data();
+    unsigned int const common = std::min(a.num_words, b.num_words);
+
+    // Whichever is longer wins if it has anything set above the other one's top word
+    for (unsigned int word = a.num_words; word-- > common;) if (wa[word]) return 1;
+    for (unsigned int word = b.num_words; word-- > common;) if (wb[word]) return -1;
+
+    return compare(wa, wb, common);
+}
+
+int GraphNumber::compare(word_type const* a, word_type const* b, unsigned int count)
+{
+    unsigned int const differ = highest_difference(a, b, count);
+    if (!differ) return 0;
+    return a[differ - 1] < b[differ - 1] ? -1 : 1;
+}
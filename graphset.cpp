@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include "pancyclic.h"
+
+GraphNumberSet::GraphNumberSet(int nvert, int num_shards, std::size_t initial_capacity) :
+    num_vertices(nvert), num_words(GraphNumber::for_vertices(nvert).size()), shard_bits(0)
+{
+    if (num_shards <= 0) num_shards = 8 * std::max(1u, std::thread::hardware_concurrency());
+    while ((1 << shard_bits) < num_shards) shard_bits++;
+
+    // Start each shard with room for its share of initial_capacity without growing
+    std::size_t const per_shard = initial_capacity / max_load / (std::size_t(1) << shard_bits) + 1;
+    std::size_t capacity = 16;
+    while (capacity < per_shard) capacity *= 2;
+    for (unsigned int shard = 0; shard < (1u << shard_bits); shard++)
+    {
+        shards.emplace_back(new Shard);
+        allocate(*shards.back(), capacity);
+    }
+}
+
+void GraphNumberSet::allocate(Shard& shard, std::size_t capacity) const
+{
+    shard.tags.reset(new std::atomic<std::uint64_t>[capacity]);
+    for (std::size_t slot = 0; slot < capacity; slot++) shard.tags[slot].store(0, std::memory_order_relaxed);
+    shard.keys.reset(new word_type[capacity * num_words]);
+    shard.capacity = capacity;
+}
+
+void GraphNumberSet::grow(Shard& shard, std::size_t seen_capacity)
+{
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    // Someone else might have beaten us to it
+    if (shard.capacity != seen_capacity) return;
+
+    auto old_tags = std::move(shard.tags);
+    auto old_keys = std::move(shard.keys);
+    allocate(shard, 2 * seen_capacity);
+
+    // Nobody else is in here, and every old slot is either empty or full, so this is a plain rehash
+    for (std::size_t old = 0; old < seen_capacity; old++)
+    {
+        std::uint64_t const tag = old_tags[old].load(std::memory_order_relaxed);
+        if (!tag) continue;
+        std::size_t slot = home_slot(shard, tag);
+        while (shard.tags[slot].load(std::memory_order_relaxed)) slot = (slot + 1) & (shard.capacity - 1);
+        shard.tags[slot].store(tag, std::memory_order_relaxed);
+        std::copy(&old_keys[old * num_words], &old_keys[(old + 1) * num_words], &shard.keys[slot * num_words]);
+    }
+}
+
+bool GraphNumberSet::insert(GraphNumber const& num)
+{
+    if (num.size() != num_words) throw std::invalid_argument("Graph number is the wrong size for the set");
+    return insert(num.data());
+}
+
+bool GraphNumberSet::insert(word_type const* words)
+{
+    std::size_t const hash = GraphNumber::hash(words, num_words);
+    std::uint64_t const hash_bits = hash & ~state_mask;
+    Shard& shard = shard_for(hash);
+
+    while (true)
+    {
+        std::size_t seen_capacity;
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            seen_capacity = shard.capacity;
+            // Count the key before claiming a slot for it, so however many threads race in here the table never
+            // gets past the load limit and probes always end at an empty slot
+            if (shard.count.fetch_add(1, std::memory_order_relaxed) + 1 <= max_load * seen_capacity)
+            {
+                std::size_t const mask = shard.capacity - 1;
+                for (std::size_t slot = home_slot(shard, hash);; slot = (slot + 1) & mask)
+                {
+                    std::atomic<std::uint64_t>& tag = shard.tags[slot];
+                    std::uint64_t seen = tag.load(std::memory_order_acquire);
+                    if (!seen)
+                    {
+                        if (tag.compare_exchange_strong(seen, hash_bits | CLAIMED, std::memory_order_acquire))
+                        {
+                            // The slot is ours, so write the key and then let everyone else see it
+                            std::copy(words, words + num_words, &shard.keys[slot * num_words]);
+                            tag.store(hash_bits | FULL, std::memory_order_release);
+                            return true;
+                        }
+                        // Lost the race, so look at what got put here instead
+                    }
+                    if ((seen & ~state_mask) != hash_bits) continue;
+                    // Same hash, so wait for the key to be written and compare it
+                    while ((seen & state_mask) == CLAIMED)
+                    {
+                        std::this_thread::yield();
+                        seen = tag.load(std::memory_order_acquire);
+                    }
+                    if (GraphNumber::compare(&shard.keys[slot * num_words], words, num_words) == 0)
+                    {
+                        shard.count.fetch_sub(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                }
+            }
+            shard.count.fetch_sub(1, std::memory_order_relaxed);
+        }
+        grow(shard, seen_capacity);
+    }
+}
+
+bool GraphNumberSet::insert_canonical(Hamiltonian const& graph)
+{
+    if (graph.get_num_vertices() != num_vertices)
+        throw std::invalid_argument("Hamiltonian has a different number of vertices than the set");
+    return insert(graph.get_graph_iso_num());
+}
+
+bool GraphNumberSet::contains(GraphNumber const& num) const
+{
+    if (num.size() != num_words) throw std::invalid_argument("Graph number is the wrong size for the set");
+    std::size_t const hash = num.hash();
+    std::uint64_t const hash_bits = hash & ~state_mask;
+    Shard const& shard = shard_for(hash);
+
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    std::size_t const mask = shard.capacity - 1;
+    for (std::size_t slot = home_slot(shard, hash);; slot = (slot + 1) & mask)
+    {
+        std::uint64_t seen = shard.tags[slot].load(std::memory_order_acquire);
+        if (!seen) return false;
+        if ((seen & ~state_mask) != hash_bits) continue;
+        while ((seen & state_mask) == CLAIMED)
+        {
+            std::this_thread::yield();
+            seen = shard.tags[slot].load(std::memory_order_acquire);
+        }
+        if (GraphNumber::compare(&shard.keys[slot * num_words], num.data(), num_words) == 0) return true;
+    }
+}
+
+std::size_t GraphNumberSet::size() const
+{
+    std::size_t total = 0;
+    for (auto const& shard : shards) total += shard->count.load(std::memory_order_relaxed);
+    return total;
+}
+
+GraphNumberSet::Stats GraphNumberSet::stats() const
+{
+    Stats stats = {};
+    stats.min_shard_load = 1;
+    std::size_t total_probe = 0;
+    for (auto const& shard : shards)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        std::size_t const count = shard->count.load(std::memory_order_relaxed);
+        stats.size += count;
+        stats.capacity += shard->capacity;
+        double const load = static_cast<double>(count) / shard->capacity;
+        stats.max_shard_load = std::max(stats.max_shard_load, load);
+        stats.min_shard_load = std::min(stats.min_shard_load, load);
+
+        for (std::size_t slot = 0; slot < shard->capacity; slot++)
+        {
+            std::uint64_t const tag = shard->tags[slot].load(std::memory_order_relaxed);
+            if (!tag) continue;
+            std::size_t const probe = (slot - home_slot(*shard, tag)) & (shard->capacity - 1);
+            total_probe += probe;
+            stats.max_probe_length = std::max(stats.max_probe_length, probe);
+        }
+    }
+    stats.load_factor = stats.capacity ? static_cast<double>(stats.size) / stats.capacity : 0;
+    stats.mean_probe_length = stats.size ? static_cast<double>(total_probe) / stats.size : 0;
+    return stats;
+}
@@ -1,5 +1,8 @@
 #include <vector>
+#include <algorithm>
 #include <string>
+#include <sstream>
+#include <stdexcept>
 #include <iterator>
 #include <functional>
 #include <unordered_map>
@@ -7,215 +10,331 @@
 #include <boost/pending/disjoint_sets.hpp>
 #include "pancyclic.h"
 
-void Hamiltonian::reset_al() {
+void Hamiltonian::reset_chords() {
     num_chords = 0;
-    chords_al.clear();
-    for (int vert = 0; vert < num_vertices; ++vert) chords_al[vert];
+    auto const max_num_chords = Chord::max_num_chords(num_vertices);
+    chord_bits.assign(max_num_chords / word_bits + (max_num_chords % word_bits ? 1 : 0), 0);
+    if (tracker.enabled) reset_tracker();
+    if (cycle_tracker.enabled) rebuild_cycle_tracker();
 }
 
-Hamiltonian::Hamiltonian() : num_chords(0), num_vertices(0) {}
+Hamiltonian::Hamiltonian() : num_vertices(0), num_chords(0) {}
 
-Hamiltonian::Hamiltonian(int nvert) : num_vertices(nvert) {reset_al();}
+Hamiltonian::Hamiltonian(int nvert) : num_vertices(nvert) {reset_chords();}
 
 
-std::unordered_map<int, Hamiltonian*> Hamiltonian::get_crossing_comp_hamil_map() const
+void Hamiltonian::union_crossing_chords(CrossingComponents::Scratch& scratch) const
 {
-    // TODO: Look into this demo from boost:
-    // https://www.boost.org/doc/libs/1_33_1/libs/graph/doc/incremental_components.html
-
-    // It's hard to make a disjoint set of chords, so I just map the chords to indices
-    std::vector<Chord> chord_vec(get_num_chords());
-    std::unordered_map<Chord, int> chord_to_idx;
-    int idx = 0;
-
-    for (Chord chord : chords())
+    // Cut the cycle open at vertex 0, so every chord is an interval [start, end] and two chords cross exactly
+    // when their intervals overlap without one containing the other
+    // Sweep the vertices in order, keeping a stack of blocks of chords that are already known to be in the same
+    // component, oldest at the bottom. When a chord ends, every block above its own still has an open chord that
+    // started after it and ends after it, so they all cross it and get merged in. Every merge removes a block,
+    // so the whole thing is O(n + k alpha(k))
+    std::vector<Chord> const& chord_vec = scratch.chords;
+    int const num = chord_vec.size();
+    scratch.rank.assign(num, 0);
+    scratch.parent.assign(num, 0);
+    boost::disjoint_sets<int*, int*> comps(scratch.rank.data(), scratch.parent.data());
+    for (int idx = 0; idx < num; idx++) comps.make_set(idx);
+
+    // chord_vec is sorted by start then end, so bucketing by end vertex keeps each bucket sorted by start
+    std::vector<int>& end_offsets = scratch.end_offsets;
+    end_offsets.assign(num_vertices + 1, 0);
+    for (auto const& chord : chord_vec) end_offsets[chord.end + 1]++;
+    for (int vert = 0; vert < num_vertices; vert++) end_offsets[vert + 1] += end_offsets[vert];
+    std::vector<int>& ends_at = scratch.ends_at;
+    ends_at.resize(num);
+    std::vector<int>& fill = scratch.fill;
+    fill.assign(end_offsets.begin(), end_offsets.end() - 1);
+    for (int idx = 0; idx < num; idx++) ends_at[fill[chord_vec[idx].end]++] = idx;
+
+    // Number of chords in each block (indexed by its root) that haven't ended yet
+    std::vector<int>& open = scratch.open;
+    open.assign(num, 0);
+    std::vector<int>& blocks = scratch.blocks;
+    blocks.clear();
+    int next_start = 0;
+    for (int vert = 0; vert < num_vertices; vert++)
     {
-        chord_to_idx[chord] = idx;
-        chord_vec[idx++] = chord;
-    }
+        // Chords sharing an endpoint don't cross, so close chords before opening the ones starting here,
+        // and close the later starting ones first so they don't get merged with each other
+        for (int pos = end_offsets[vert + 1]; pos-- > end_offsets[vert];)
+        {
+            int const idx = ends_at[pos];
+            int root = comps.find_set(idx);
+            while (comps.find_set(blocks.back()) != root)
+            {
+                int const above = comps.find_set(blocks.back());
+                blocks.pop_back();
+                int const total = open[above] + open[root];
+                comps.link(above, root);
+                root = comps.find_set(idx);
+                open[root] = total;
+            }
+            if (--open[root] == 0) blocks.pop_back();
+        }
 
-    // For some reason, I have to do this to make the disjoint set use arrays to store ranks and parents
-    std::vector<int> rank(get_num_chords());
-    std::vector<int> parent(get_num_chords());
-    boost::disjoint_sets<int*, int*> comps(&rank[0], &parent[0]);
+        // Open the longest chord first, so chords sharing a start don't look nested the wrong way
+        int group_end = next_start;
+        while (group_end < num && chord_vec[group_end].start == vert) group_end++;
+        for (int idx = group_end; idx-- > next_start;)
+        {
+            open[idx] = 1;
+            blocks.push_back(idx);
+        }
+        next_start = group_end;
+    }
 
-    // Add all chords to disjoint sets
-    for (auto const& chord : chord_vec) comps.make_set(chord_to_idx[chord]);
+    for (int idx = 0; idx < num; idx++) scratch.parent[idx] = comps.find_set(idx);
+}
 
-    // For each pair of crossing chords, combine the sets
-    for (auto it1 = chord_vec.begin(); it1 != std::prev(chord_vec.end()); ++it1)
+void Hamiltonian::crossing_components(CrossingComponents& out) const
+{
+    PANCYCLIC_TIME(COMPONENTS);
+    out.num_vertices = num_vertices;
+    out.grouped.clear();
+    out.offsets.assign(1, 0);
+    CrossingComponents::Scratch& scratch = out.scratch;
+
+    // Tracked components just have to be read off their lists
+    if (tracker.enabled)
     {
-        for (auto it2 = std::next(it1); it2 != chord_vec.end(); ++it2)
+        for (int root : tracker.roots)
         {
-            if (it1->crossing(*it2)) comps.union_set(chord_to_idx[*it2], chord_to_idx[*it1]);
+            auto const first = out.grouped.size();
+            int idx = root;
+            do
+            {
+                out.grouped.push_back(Chord::from_index(idx, num_vertices));
+                idx = tracker.next[idx];
+            } while (idx != root);
+            std::sort(out.grouped.begin() + first, out.grouped.end());
+            out.offsets.push_back(out.grouped.size());
         }
+        PANCYCLIC_RECORD_COMPONENTS(out.size());
+        return;
     }
 
-    // Make map of Hamiltonians
-    std::unordered_map<int, Hamiltonian*> comps_map;
-    for (auto const& chord : chord_vec)
+    // chords() comes out sorted by start then end, which is what the sweep needs
+    chord_vector(scratch.chords);
+    union_crossing_chords(scratch);
+
+    // Counting sort by component, numbering components by their first chord
+    int const num = scratch.chords.size();
+    std::vector<int>& comp_of_root = scratch.open;
+    comp_of_root.assign(num, -1);
+    std::vector<unsigned int>& sizes = scratch.sizes;
+    sizes.clear();
+    for (int idx = 0; idx < num; idx++)
     {
-        // Would like to use custom allocator, but that's far too complicated
-        int comp = comps.find_set(chord_to_idx[chord]);
-        if (comps_map.find(comp) == comps_map.end()) comps_map[comp] = new Hamiltonian(num_vertices);
-        comps_map[comp]->add_chord(chord);
+        int& comp = comp_of_root[scratch.parent[idx]];
+        if (comp < 0)
+        {
+            comp = sizes.size();
+            sizes.push_back(0);
+        }
+        sizes[comp]++;
     }
+    for (unsigned int size : sizes) out.offsets.push_back(out.offsets.back() + size);
+
+    out.grouped.resize(num);
+    std::vector<int>& fill = scratch.fill;
+    fill.assign(out.offsets.begin(), out.offsets.end() - 1);
+    for (int idx = 0; idx < num; idx++) out.grouped[fill[comp_of_root[scratch.parent[idx]]]++] = scratch.chords[idx];
+    PANCYCLIC_RECORD_COMPONENTS(out.size());
+}
 
-    return comps_map;
+CrossingComponents Hamiltonian::crossing_components() const
+{
+    CrossingComponents comps;
+    crossing_components(comps);
+    return comps;
 }
 
 // Unordered multiset would be more appropriate, but it would be a nightmare to implement the hash function
 std::vector<Hamiltonian> Hamiltonian::get_crossing_components() const
 {
-    std::unordered_map<int, Hamiltonian*> comp_to_hamil = get_crossing_comp_hamil_map();
-
-    // Make and return a vector of Hamiltonians, one for each chord component
-    std::vector<Hamiltonian> ret_vec;
-    for (auto& num_graph : comp_to_hamil)
-    {
-        ret_vec.push_back(*(num_graph.second));
-        delete num_graph.second;
-    }
-    return ret_vec;
+    return crossing_components().to_hamiltonians();
 }
 
-std::unordered_map<Chord, Hamiltonian*> Hamiltonian::get_crossing_components_map() const
+std::vector<std::shared_ptr<Hamiltonian>> Hamiltonian::get_crossing_components_map() const
 {
-    std::unordered_map<int, Hamiltonian*> comp_to_hamil = get_crossing_comp_hamil_map();
-    std::unordered_map<Chord, Hamiltonian*> chord_to_hamil;
-    for (auto& comp_hamil : comp_to_hamil)
+    PANCYCLIC_TIME(COMPONENT_MAP);
+    CrossingComponents comps = crossing_components();
+    std::vector<std::shared_ptr<Hamiltonian>> chord_to_hamil(Chord::max_num_chords(num_vertices));
+    for (std::size_t comp = 0; comp < comps.size(); comp++)
     {
-        for (Chord chord : chords()) chord_to_hamil[chord] = comp_hamil.second;
+        auto hamil = std::make_shared<Hamiltonian>(comps.to_hamiltonian(comp));
+        for (Chord chord : comps[comp]) chord_to_hamil[chord.index()] = hamil;
     }
-
     return chord_to_hamil;
 }
 
-std::vector<short> Hamiltonian::get_graph_num() const
+void Hamiltonian::reset_tracker()
 {
-    // Not very fast for sparse graphs
-    // For sparse graphs, consider calculating the bit position instead of looping through all possible edges
-    // Would it be faster to make an adjacency list?
-
-    // Formula for max number of chords: n C 2 - n (because n edges are assumed)
-    const unsigned int num_bits = 8 * sizeof(short);
     auto const max_num_chords = Chord::max_num_chords(num_vertices);
-    const unsigned int rem = max_num_chords % sizeof(short);
+    tracker.rank.assign(max_num_chords, 0);
+    tracker.parent.assign(max_num_chords, 0);
+    tracker.next.assign(max_num_chords, 0);
+    tracker.root_pos.assign(max_num_chords, 0);
+    tracker.roots.clear();
+    tracker.row_words = num_vertices / word_bits + (num_vertices % word_bits ? 1 : 0);
+    tracker.adjacency.assign(tracker.row_words * num_vertices, 0);
+}
 
-    // Round size up to align with short
-    std::vector<short> ret(max_num_chords / num_bits + (rem ? num_bits - rem : 0));
-    unsigned long int idx = 0;
-    for (int start = 0; start < num_vertices - 2; start++)
+void Hamiltonian::track_crossing_components(bool track)
+{
+    if (track == tracker.enabled) return;
+    if (!track)
     {
-        // A chord starting at idx 0 cannot end at num_vertices-1, so I have to adjust
-        // Hence the - (start ? 0 : 1)
-        for (int end = start+2; end < num_vertices - (start ? 0 : 1); end++)
-        {
-            unsigned long int div = idx / num_bits;
-            ret[div] |= chords_al.at(start).count(end) << (idx++ % num_bits);
-        }
+        tracker = ComponentTracker();
+        return;
     }
-    return ret;
+
+    tracker.enabled = true;
+    rebuild_tracker();
 }
 
-Hamiltonian::Hamiltonian(int nvert, std::vector<short> const& graph_num) : num_chords(0), num_vertices(nvert)
+void Hamiltonian::rebuild_tracker()
 {
-    reset_al();
-    const unsigned int num_bits = 8 * sizeof(short);
-    auto const max_num_chords = Chord::max_num_chords(num_vertices);
-    const unsigned int rem = max_num_chords % sizeof(short);
+    reset_tracker();
+    for (Chord chord : chords()) track_chord(chord.index(), chord.start, chord.end);
+}
 
-    // Round size up to align with short
-    unsigned long int idx = 0;
-    Chord iter_chord(0, 1, num_vertices);
-    for (int start = 0; start < num_vertices - 2; start++)
+int Hamiltonian::get_num_crossing_components() const
+{
+    if (tracker.enabled) return tracker.roots.size();
+    // Same spare buffer trick as transform, so counting doesn't allocate once it's warmed up
+    thread_local CrossingComponents components;
+    crossing_components(components);
+    return components.size();
+}
+
+void Hamiltonian::track_chord(unsigned long int idx, int start, int end)
+{
+    // The tracker's tables hold ints, so work with the chord bit as one too
+    int const chord = static_cast<int>(idx);
+    boost::disjoint_sets<int*, int*> comps(tracker.rank.data(), tracker.parent.data());
+    comps.make_set(chord);
+    tracker.next[chord] = chord;
+    tracker.root_pos[chord] = tracker.roots.size();
+    tracker.roots.push_back(chord);
+
+    // The chords crossing this one go from a vertex strictly inside it to a vertex strictly outside it
+    unsigned int const row_words = tracker.row_words;
+    for (int inside = start + 1; inside < end; inside++)
     {
-        iter_chord.start = start;
-        // A chord starting at idx 0 cannot end at num_vertices-1, so I have to adjust
-        // Hence the - (start ? 0 : 1)
-        for (int end = start+2; end < num_vertices - (start ? 0 : 1); end++)
+        word_type const* row = &tracker.adjacency[inside * row_words];
+        for (unsigned int word = 0; word < row_words; word++)
         {
-            iter_chord.end = end;
-            unsigned long int div = idx / num_bits;
-            if ((graph_num[div] >> (idx++ % num_bits)) & 1) add_chord(iter_chord);
+            // Mask off [start, end] so only the outside is left
+            word_type bits = row[word];
+            int const lo = word * word_bits;
+            int const first = std::max(start - lo, 0);
+            int const last = std::min(end - lo, static_cast<int>(word_bits) - 1);
+            if (first <= last) bits &= ~((~word_type(0) >> (word_bits - 1 - last)) & (~word_type(0) << first));
+
+            for (; bits; bits &= bits - 1)
+            {
+                int const outside = lo + __builtin_ctzll(bits);
+                int const a = comps.find_set(chord);
+                int const b = comps.find_set(static_cast<int>(Chord::index(std::min(inside, outside), std::max(inside, outside), num_vertices)));
+                if (a == b) continue;
+
+                comps.link(a, b);
+                int const lost = comps.find_set(chord) == a ? b : a;
+                std::swap(tracker.next[a], tracker.next[b]);
+                // Swap-pop the root that went away
+                int const moved = tracker.roots.back();
+                tracker.roots[tracker.root_pos[lost]] = moved;
+                tracker.root_pos[moved] = tracker.root_pos[lost];
+                tracker.roots.pop_back();
+            }
         }
     }
+
+    tracker.adjacency[start * row_words + end / word_bits] |= word_type(1) << (end % word_bits);
+    tracker.adjacency[end * row_words + start / word_bits] |= word_type(1) << (start % word_bits);
 }
 
-std::vector<short> Hamiltonian::get_graph_iso_num() const
+GraphNumber Hamiltonian::get_graph_num() const
 {
-    Hamiltonian copy = *this;
-    std::vector<short> min = get_graph_num();
-    for (int i = 0; i < num_vertices-1; i++)
-    {
-        copy.rotate();
-        std::vector<short> new_num = copy.get_graph_num();
-        if (new_num < min) min = new_num;
-    }
-    copy.reflect();
-    std::vector<short> new_num = copy.get_graph_num();
-    if (new_num < min) min = new_num;
-    for (int i = 0; i < num_vertices-1; i++)
-    {
-        copy.rotate();
-        std::vector<short> new_num = copy.get_graph_num();
-        if (new_num < min) min = new_num;
-    }
+    PANCYCLIC_TIME(ENCODE);
+    // The chord bits are already in graph number order
+    return GraphNumber(chord_bits.data(), chord_bits.size());
+}
 
-    return min;
+Hamiltonian::Hamiltonian(int nvert, GraphNumber const& graph_num) : num_vertices(nvert)
+{
+    PANCYCLIC_TIME(DECODE);
+    reset_chords();
+    std::copy(graph_num.data(), graph_num.data() + std::min<std::size_t>(graph_num.size(), chord_bits.size()), chord_bits.begin());
+
+    // Don't let stray bits past the last chord turn into chords
+    auto const max_num_chords = Chord::max_num_chords(num_vertices);
+    if (max_num_chords % word_bits) chord_bits.back() &= (word_type(1) << (max_num_chords % word_bits)) - 1;
+    for (word_type word : chord_bits) num_chords += __builtin_popcountll(word);
 }
 
-std::string Hamiltonian::get_graph_num_digs(int nverts, std::vector<short> graph_num)
+GraphNumber Hamiltonian::get_graph_iso_num() const
 {
-    std::string ret_str;
-    const unsigned int num_bits = 8 * sizeof(short);
-    auto max_num_chords = Chord::max_num_chords(nverts);
+    PANCYCLIC_TIME(CANONICALIZE);
+    PANCYCLIC_RECORD_CHORDS(num_chords);
+    // The canonical form has the same chords, just moved around, so it can be written straight out
+    GraphNumber iso(chord_bits.size());
+    if (CanonicalCache* cache = CanonicalCache::global(num_vertices)) cache->canonical_form(chord_bits.data(), iso.data());
+    else Canonicalizer::for_vertices(num_vertices).canonical_form(*this, iso.data());
+    return iso;
+}
 
-    for (long unsigned int i = 0; i < max_num_chords; i++)
+std::string Hamiltonian::get_graph_num_digs(int nverts, GraphNumber const& graph_num)
+{
+    PANCYCLIC_TIME(ENCODE);
+    auto const max_num_chords = Chord::max_num_chords(nverts);
+    std::string ret_str(max_num_chords, '0');
+    for (unsigned long int i = 0; i < max_num_chords && i / word_bits < graph_num.size(); i++)
     {
-        long unsigned int div = i / num_bits;
-        ret_str += std::to_string((graph_num[div] >> (i % num_bits)) & 1);
+        if (graph_num.test(i)) ret_str[i] = '1';
     }
     return ret_str;
 }
 
 
-void Hamiltonian::chord_based_transform(std::function<Chord(Chord)> transform) 
+void Hamiltonian::transform(Dihedral const& element)
 {
-    // TODO: Make more efficient? Each chord is copied a lot.
-    std::vector<Chord> new_chords(get_num_chords());
-    int idx = 0;
-    for (Chord chord : chords()) new_chords[idx++] = transform(chord);
-
-    reset_al();
-    for (Chord chord : new_chords) add_chord(chord);
+    PANCYCLIC_TIME(TRANSFORM);
+    if (element.get_num_vertices() != num_vertices)
+        throw std::invalid_argument("Group element is for a different number of vertices than the graph");
+
+    // The moved bits go into a spare buffer that's swapped in, so after the first call nothing is allocated
+    thread_local std::vector<word_type> moved;
+    moved.resize(chord_bits.size());
+    Canonicalizer::for_vertices(num_vertices).transform(element.get_element(), chord_bits.data(), moved.data());
+    chord_bits.swap(moved);
+    if (tracker.enabled) rebuild_tracker();
+    if (cycle_tracker.enabled) rebuild_cycle_tracker(true);
 }
 
-void Hamiltonian::rotate(int rotation)
+void Hamiltonian::canonicalize()
 {
-    auto rotator = [rotation](Chord c)
-    {
-        Chord copy = c;
-        copy.rotate(rotation);
-        return copy;
-    };
-
-    chord_based_transform(rotator);
+    PANCYCLIC_TIME(CANONICALIZE);
+    PANCYCLIC_RECORD_CHORDS(num_chords);
+    // Same spare buffer trick as transform
+    thread_local std::vector<word_type> canon;
+    canon.resize(chord_bits.size());
+    if (CanonicalCache* cache = CanonicalCache::global(num_vertices)) cache->canonical_form(chord_bits.data(), canon.data());
+    else Canonicalizer::for_vertices(num_vertices).canonical_form(chord_bits.data(), canon.data());
+    chord_bits.swap(canon);
+    if (tracker.enabled) rebuild_tracker();
+    if (cycle_tracker.enabled) rebuild_cycle_tracker(true);
 }
 
-void Hamiltonian::rotate() {rotate(1);}
+void Hamiltonian::rotate(int rotation) {transform(Dihedral::rotate(num_vertices, rotation));}
 
-void Hamiltonian::reflect(int vertex)
-{
-    auto reflector = [vertex](Chord c)
-    {
-        Chord copy = c;
-        copy.reflect(vertex);
-        return copy;
-    };
+void Hamiltonian::rotate() {rotate(1);}
 
-    chord_based_transform(reflector);
-}
+void Hamiltonian::reflect(int vertex) {transform(Dihedral::reflect(num_vertices, vertex));}
 
 void Hamiltonian::reflect() {reflect(0);}
 
@@ -227,7 +346,7 @@ std::string Hamiltonian::describe(bool w_graph_num, bool w_graph_iso_num) const
     out << "Number of chords: " << get_num_chords() << std::endl;
 
     out << "Chords:" << std::endl;
-    for (Chord chord : chords()) out << '\t' << chord << std::endl;
+    for (Chord const& chord : chords()) out << '\t' << chord << std::endl;
 
     if (w_graph_num)
     {
@@ -243,73 +362,114 @@ std::string Hamiltonian::describe(bool w_graph_num, bool w_graph_iso_num) const
     return out.str();
 }
 
+unsigned long int Hamiltonian::checked_chord_bit(Chord const& chord) const
+{
+    if (chord.num_vertices != num_vertices)
+        throw std::invalid_argument("Chord has a different number of vertices than the graph");
+    if (chord.end - chord.start < 2 || (chord.start == 0 && chord.end == num_vertices - 1))
+        throw std::invalid_argument("Chord is an edge of the Hamiltonian cycle");
+    return chord.index();
+}
+
 void Hamiltonian::add_chord(Chord const& chord)
 {
+    auto const idx = checked_chord_bit(chord);
+    word_type const mask = word_type(1) << (idx % word_bits);
+    if (chord_bits[idx / word_bits] & mask) return;
+    chord_bits[idx / word_bits] |= mask;
     num_chords++;
-    chords_al[chord.start].insert(chord.end);
+    if (tracker.enabled) track_chord(idx, chord.start, chord.end);
+    if (cycle_tracker.enabled) track_cycles(idx, chord.start, chord.end);
+}
+
+void Hamiltonian::remove_chord(Chord const& chord)
+{
+    auto const idx = checked_chord_bit(chord);
+    word_type const mask = word_type(1) << (idx % word_bits);
+    if (!(chord_bits[idx / word_bits] & mask)) return;
+    chord_bits[idx / word_bits] &= ~mask;
+    num_chords--;
+
+    if (tracker.enabled) rebuild_tracker();
+    if (cycle_tracker.enabled)
+    {
+        auto& undo = cycle_tracker.undo;
+        if (undo.empty() || undo.back().first != idx) rebuild_cycle_tracker();
+        else
+        {
+            cycle_tracker.lengths = undo.back().second;
+            undo.pop_back();
+            cycle_tracker.adjacency[chord.start] &= ~(std::uint64_t(1) << chord.end);
+            cycle_tracker.adjacency[chord.end] &= ~(std::uint64_t(1) << chord.start);
+        }
+    }
 }
 
+bool Hamiltonian::has_chord(Chord const& chord) const {return has_chord_bit(checked_chord_bit(chord));}
+
 
 Hamiltonian::ChordsRange Hamiltonian::chords() const
 {
     return ChordsRange(this);
 }
 
-void Hamiltonian::ChordsRange::ChordsALIterator::reset_inner()
+void Hamiltonian::chord_vector(std::vector<Chord>& out) const
 {
-    if (outer_iter != outer->cend())
-    {
-        inner = &(outer_iter->second);
-        inner_iter = inner->cbegin();
-    }
-    else
-    {
-        inner = nullptr;
-        inner_iter = inner_AL_iter();
-    }
+    out.clear();
+    out.reserve(num_chords);
+    for (Chord const& chord : chords()) out.push_back(chord);
 }
 
-void Hamiltonian::ChordsRange::ChordsALIterator::update_chord()
+std::vector<Chord> Hamiltonian::chord_vector() const
 {
-    if (outer_iter == outer->cend()) return;
-    curr_chord->start = outer_iter->first;
-    curr_chord->end = *inner_iter;
+    std::vector<Chord> ret;
+    chord_vector(ret);
+    return ret;
 }
 
-Hamiltonian::ChordsRange::ChordsALIterator::ChordsALIterator(Hamiltonian const* hamil, bool end) : outer(&(hamil->chords_al))
+Hamiltonian::ChordsRange::ChordsALIterator::ChordsALIterator(Hamiltonian const* theHamil, bool end) :
+    curr_chord(), hamil(theHamil), next_row(Chord::row_offset(1, theHamil->num_vertices))
 {
-    curr_chord = new value_type;
-    curr_chord->num_vertices = hamil->num_vertices;
-    
-    outer_iter = end ? outer->cend() : outer->cbegin();
-    inner_iter = inner_AL_iter();
-    seek_chord();
+    curr_chord.num_vertices = hamil->num_vertices;
+    curr_chord.start = 0;
+    curr_chord.end = 2;
+
+    idx = end ? Chord::max_num_chords(hamil->num_vertices) : 0;
+    if (!end) seek_chord();
 }
 
 Hamiltonian::ChordsRange::ChordsALIterator Hamiltonian::ChordsRange::begin() const {return ChordsALIterator(hamil);}
 Hamiltonian::ChordsRange::ChordsALIterator Hamiltonian::ChordsRange::end() const {return ChordsALIterator(hamil, true);}
 
-
-Hamiltonian::ChordsRange::ChordsALIterator::~ChordsALIterator() {delete curr_chord;}
-
-Hamiltonian::ChordsRange::ChordsALIterator::value_type Hamiltonian::ChordsRange::ChordsALIterator::operator*() {return *curr_chord;}
-Hamiltonian::ChordsRange::ChordsALIterator::pointer Hamiltonian::ChordsRange::ChordsALIterator::operator->() {return curr_chord;}
-
 void Hamiltonian::ChordsRange::ChordsALIterator::seek_chord()
 {
-    if (inner_iter == inner->cend() || inner_iter == inner_AL_iter()) {
-        while (outer_iter != outer->cend() && (inner_iter == inner->cend() || inner_iter == inner_AL_iter()))
+    // Skip ahead to the next set bit, a whole word at a time
+    auto const max_num_chords = Chord::max_num_chords(hamil->num_vertices);
+    while (idx < max_num_chords)
+    {
+        word_type word = hamil->chord_bits[idx / word_bits] >> (idx % word_bits);
+        if (word)
         {
-            ++outer_iter;
-            reset_inner();
+            idx += __builtin_ctzll(word);
+            break;
         }
+        idx += word_bits - idx % word_bits;
+    }
+    if (idx >= max_num_chords)
+    {
+        idx = max_num_chords;
+        return;
     }
-    update_chord();
+
+    // Chords only move forward, so walking the rows is amortized over the whole iteration
+    int& start = curr_chord.start;
+    while (idx >= next_row) next_row = Chord::row_offset(++start + 1, hamil->num_vertices);
+    curr_chord.end = static_cast<int>(idx - Chord::row_offset(start, hamil->num_vertices)) + start + 2;
 }
 
 Hamiltonian::ChordsRange::ChordsALIterator& Hamiltonian::ChordsRange::ChordsALIterator::operator++()
 {
-    ++inner_iter;
+    ++idx;
     seek_chord();
     return *this;
 }
@@ -322,4 +482,4 @@ Hamiltonian::ChordsRange::ChordsALIterator Hamiltonian::ChordsRange::ChordsALIte
 }
 
 bool operator==(Hamiltonian::ChordsRange::ChordsALIterator const& a, Hamiltonian::ChordsRange::ChordsALIterator const& b)
-{return a.outer_iter == b.outer_iter && a.inner_iter == b.inner_iter;}
+{return a.hamil == b.hamil && a.idx == b.idx;}
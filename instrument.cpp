@@ -0,0 +1,175 @@
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "pancyclic.h"
+
+namespace
+{
+    void dump_histogram(std::ostream& out, std::vector<unsigned long long int> const& histogram)
+    {
+        out << '{';
+        bool first = true;
+        for (std::size_t value = 0; value < histogram.size(); value++)
+        {
+            if (!histogram[value]) continue;
+            if (!first) out << ", ";
+            first = false;
+            // The last bucket is everything from there up
+            out << '"' << value << (value + 1 == histogram.size() ? "+" : "") << "\": " << histogram[value];
+        }
+        out << '}';
+    }
+}
+
+
+void Instrumentation::Block::clear()
+{
+    for (auto& counter : calls) counter.store(0, std::memory_order_relaxed);
+    for (auto& counter : ticks) counter.store(0, std::memory_order_relaxed);
+    for (auto& counter : chord_counts) counter.store(0, std::memory_order_relaxed);
+    for (auto& counter : component_counts) counter.store(0, std::memory_order_relaxed);
+}
+
+void Instrumentation::Block::add(Block const& other)
+{
+    for (int phase = 0; phase < NUM_PHASES; phase++)
+    {
+        calls[phase].fetch_add(other.calls[phase].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        ticks[phase].fetch_add(other.ticks[phase].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    for (int bucket = 0; bucket <= histogram_buckets; bucket++)
+    {
+        chord_counts[bucket].fetch_add(other.chord_counts[bucket].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        component_counts[bucket].fetch_add(other.component_counts[bucket].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+Instrumentation::Registry& Instrumentation::registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+Instrumentation::ThreadBlock::~ThreadBlock()
+{
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    all.retired.add(*block);
+    for (auto& live : all.blocks)
+    {
+        if (live.get() != block) continue;
+        live.swap(all.blocks.back());
+        all.blocks.pop_back();
+        break;
+    }
+    current = nullptr;
+    retired_thread = true;
+}
+
+Instrumentation::Block& Instrumentation::new_thread_block()
+{
+    // Only made the first time through, so the plain pointer is all the hot path looks at
+    thread_local ThreadBlock owner;
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    all.blocks.emplace_back(new Block);
+    current = owner.block = all.blocks.back().get();
+    return *current;
+}
+
+void Instrumentation::update_retired(void (*update)(Block&, void const*), void const* context)
+{
+    // Other threads add into the retired total as they exit, so this has to hold the lock too
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    update(all.retired, context);
+}
+
+Instrumentation::ScopedTimer::~ScopedTimer()
+{
+    std::uint64_t const elapsed = ticks() - begin;
+    Phase const phase = this->phase;
+    update([phase, elapsed](Block& block)
+    {
+        bump(block.calls[phase]);
+        bump(block.ticks[phase], elapsed);
+    });
+}
+
+char const* Instrumentation::phase_name(Phase phase)
+{
+    switch (phase)
+    {
+        case CANONICALIZE: return "canonicalize";
+        case TRANSFORM: return "transform";
+        case COMPONENTS: return "components";
+        case COMPONENT_MAP: return "component_map";
+        case ENCODE: return "encode";
+        case DECODE: return "decode";
+        default: return "unknown";
+    }
+}
+
+Instrumentation::Snapshot Instrumentation::snapshot()
+{
+    Snapshot ret;
+    ret.chord_counts.assign(histogram_buckets + 1, 0);
+    ret.component_counts.assign(histogram_buckets + 1, 0);
+
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    double const elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - all.start_time).count();
+    std::uint64_t const elapsed_ticks = ticks() - all.start_ticks;
+    double const ns_per_tick = elapsed_ticks ? elapsed_ns / elapsed_ticks : 1;
+    Block total;
+    total.add(all.retired);
+    for (auto const& block : all.blocks) total.add(*block);
+    for (int phase = 0; phase < NUM_PHASES; phase++)
+    {
+        ret.phases[phase].calls = total.calls[phase].load(std::memory_order_relaxed);
+        ret.phases[phase].nanoseconds = total.ticks[phase].load(std::memory_order_relaxed) * ns_per_tick;
+    }
+    for (int bucket = 0; bucket <= histogram_buckets; bucket++)
+    {
+        ret.chord_counts[bucket] = total.chord_counts[bucket].load(std::memory_order_relaxed);
+        ret.component_counts[bucket] = total.component_counts[bucket].load(std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+void Instrumentation::reset()
+{
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    all.retired.clear();
+    for (auto const& block : all.blocks) block->clear();
+}
+
+void Instrumentation::dump_json(std::ostream& out)
+{
+    Snapshot const stats = snapshot();
+    out << "{\"enabled\": " << (enabled ? "true" : "false") << ", \"phases\": {";
+    for (int phase = 0; phase < NUM_PHASES; phase++)
+    {
+        PhaseStats const& phase_stats = stats.phases[phase];
+        out << (phase ? ", " : "") << '"' << phase_name(static_cast<Phase>(phase)) << "\": {\"calls\": " << phase_stats.calls
+            << ", \"ns\": " << phase_stats.nanoseconds
+            << ", \"mean_ns\": " << (phase_stats.calls ? static_cast<double>(phase_stats.nanoseconds) / phase_stats.calls : 0) << '}';
+    }
+    out << "}, \"chord_counts\": ";
+    dump_histogram(out, stats.chord_counts);
+    out << ", \"component_counts\": ";
+    dump_histogram(out, stats.component_counts);
+    out << '}';
+}
+
+std::string Instrumentation::to_json()
+{
+    std::ostringstream out;
+    dump_json(out);
+    return out.str();
+}
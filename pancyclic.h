@@ -2,6 +2,13 @@
 #define PANCYCLIC_H
 
 #include <vector>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
 #include <unordered_set>
 #include <functional>
 #include <iostream>
@@ -9,6 +16,16 @@
 #include <cstddef>
 #include <string>
 #include <type_traits>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <boost/dynamic_bitset.hpp>
 
 
 enum turning
@@ -27,6 +44,43 @@ turning get_turning(int start, int mid, int end);
 class Chord;
 template<>
 struct std::hash<Chord>;
+
+// All-pairs version of Chord::crossing, packed into bits
+// Bit j of row i is set if chords i and j cross (so it's symmetric, with an empty diagonal)
+// Nothing in the library wants every pair at once: components come from a sweep, the trackers only ever need the
+// chords crossing one new chord, and the cycle search needs how two chords sit, not just whether they cross. So
+// this is for callers that want the whole circle graph
+class CrossingMatrix
+{
+    public:
+        using word_type = std::uint64_t;
+        static constexpr unsigned int word_bits = 8 * sizeof(word_type);
+
+        // Which kernel fills the matrix. AUTO picks AVX2 if the CPU has it
+        enum Kernel
+        {
+            AUTO,
+            SCALAR,
+            AVX2
+        };
+
+        CrossingMatrix() : num_chords(0), row_words(0) {}
+        CrossingMatrix(std::vector<Chord> const& chords, Kernel kernel=AUTO);
+
+        std::size_t size() const {return num_chords;}
+        unsigned int get_row_words() const {return row_words;}
+        word_type const* row(std::size_t idx) const {return &bits[idx * row_words];}
+        bool crossing(std::size_t a, std::size_t b) const {return (row(a)[b / word_bits] >> (b % word_bits)) & 1;}
+
+        static bool kernel_supported(Kernel kernel);
+
+    private:
+        std::size_t num_chords;
+        unsigned int row_words;
+        std::vector<word_type> bits;
+};
+
+
 class Chord
 {
     private:
@@ -35,12 +89,42 @@ class Chord
         int start;
         int end;
 
-        void reorder();
+        constexpr void reorder()
+        {
+            start %= num_vertices;
+            if (start < 0) start += num_vertices;
+            end %= num_vertices;
+            if (end < 0) end += num_vertices;
+            if (end < start)
+            {
+                int tmp = start;
+                start = end;
+                end = tmp;
+            }
+        }
+
+        // Floor of the square root, by Newton's method from a power of two above it
+        static constexpr unsigned long int isqrt(unsigned long int x)
+        {
+            if (x < 2) return x;
+            unsigned long int guess = 1UL << ((64 - __builtin_clzll(x) + 1) / 2);
+            while (true)
+            {
+                unsigned long int const next = (guess + x / guess) / 2;
+                if (next >= guess) return guess;
+                guess = next;
+            }
+        }
     public:
         // For some reason, some random piece of code needs this
-        Chord();
-        Chord(int start, int end, int nvert);
-        Chord(Chord const& other);
+        constexpr Chord() : num_vertices(0), start(0), end(0) {}
+        constexpr Chord(int start, int end, int nvert) : num_vertices(nvert), start(start), end(end) {reorder();}
+        constexpr Chord(Chord const& other) = default;
+        constexpr Chord& operator=(Chord const& other) = default;
+
+        constexpr int get_num_vertices() const {return num_vertices;}
+        constexpr int get_start() const {return start;}
+        constexpr int get_end() const {return end;}
 
         void rotate(int rotation);
         void rotate();
@@ -48,8 +132,33 @@ class Chord
         void reflect();
 
         bool crossing(Chord const& other) const;
+        // Every pair at once, vectorized when the CPU allows it
+        static CrossingMatrix crossing_matrix(std::vector<Chord> const& chords, CrossingMatrix::Kernel kernel=CrossingMatrix::AUTO);
 
-        static unsigned long int max_num_chords(int nvert);
+        // The biggest n anything here supports, since max_num_chords works in int and n(n-3) overflows past this
+        static constexpr int max_vertices = 46340;
+        // There's no room for chords below 4 vertices (and the formula would go negative below 3)
+        static constexpr unsigned long int max_num_chords(int nvert) {return nvert < 3 ? 0 : nvert * (nvert - 3) / 2;}
+
+        // Chords are numbered 0 .. max_num_chords(n)-1 by start, then end, which is also their bit in a graph number
+        // Only defined for actual chords, i.e. not edges of the Hamiltonian cycle
+        // Index of the first chord starting at start. Row 0 is one chord short, since (0, nvert-1) is an edge,
+        // and every other row r has the chords (r, r+2) ... (r, nvert-1)
+        static constexpr unsigned long int row_offset(int start, int nvert)
+        {return start ? static_cast<unsigned long int>(start) * (nvert - 2) - start * (start - 1) / 2 - 1 : 0;}
+        static constexpr unsigned long int index(int start, int end, int nvert) {return row_offset(start, nvert) + (end - start - 2);}
+        constexpr unsigned long int index() const {return index(start, end, num_vertices);}
+        // Inverse of index(). Rows start at row_offset(s) + 1 = s(2n - 3 - s) / 2 for s >= 1, so the start is the
+        // smaller root of that quadratic, rounded down
+        static constexpr Chord from_index(unsigned long int idx, int nvert)
+        {
+            long int const b = 2 * nvert - 3;
+            unsigned long int const disc = b * b - 8 * (idx + 1);
+            int start = static_cast<int>((b - static_cast<long int>(isqrt(disc))) / 2);
+            // Flooring the square root can only push start up, and by at most one
+            if (row_offset(start, nvert) > idx) start--;
+            return Chord(start, static_cast<int>(idx - row_offset(start, nvert)) + start + 2, nvert);
+        }
 
         friend bool operator<(Chord const& a, Chord const& b);
         friend bool operator==(Chord const& a, Chord const& b);
@@ -58,6 +167,7 @@ class Chord
         friend struct std::hash<Chord>;
 
         friend class Hamiltonian;
+        friend class Canonicalizer;
 };
 
 // For some reason, this has to be in the header
@@ -68,17 +178,53 @@ namespace std {
     {
         std::size_t operator() (Chord const& c) const noexcept
         {
-            // TODO: research into better hash function?
-            // Don't care abt security, just have to minimize collisions, if possible
-            std::size_t h1 = std::hash<int>{}(c.start);
-            std::size_t h2 = std::hash<int>{}(c.end);
-            // Not hashing num_vertices because I don't think I'll be using multiple chords of different num_vertices in the same table
-            return h1 ^ (h2 << 1);
+            // start * n + end never collides for chords with the same n, and unlike index() it's fine with edges too
+            // num_vertices goes in the high bits so chords of different sizes mostly stay apart as well
+            return (static_cast<std::size_t>(c.num_vertices) << 32) ^ (static_cast<std::size_t>(c.start) * c.num_vertices + c.end);
         }
     };
 }
 
 
+// An element of the dihedral group of the n-cycle: v -> v + rotation, or v -> rotation - v if it's reflected
+// Elements are numbered the same way as Canonicalizer's, so rotate(e) for e < n, and reflect() then rotate(e - n) after that
+class Dihedral
+{
+    private:
+        int num_vertices;
+        int rotation;
+        bool reflected;
+
+        constexpr Dihedral(int nvert, int rotation, bool reflected) :
+            num_vertices(nvert), rotation(((rotation % nvert) + nvert) % nvert), reflected(reflected) {}
+
+    public:
+        constexpr Dihedral() : num_vertices(0), rotation(0), reflected(false) {}
+        constexpr Dihedral(int nvert, unsigned int element) : Dihedral(nvert, element % nvert, static_cast<int>(element) >= nvert) {}
+
+        static constexpr Dihedral identity(int nvert) {return Dihedral(nvert, 0, false);}
+        static constexpr Dihedral rotate(int nvert, int rotation) {return Dihedral(nvert, rotation, false);}
+        // Same as Chord::reflect(vertex)
+        static constexpr Dihedral reflect(int nvert, int vertex) {return Dihedral(nvert, 2 * vertex, true);}
+
+        constexpr int get_num_vertices() const {return num_vertices;}
+        constexpr int get_rotation() const {return rotation;}
+        constexpr bool is_reflected() const {return reflected;}
+        constexpr int get_element() const {return reflected ? num_vertices + rotation : rotation;}
+
+        constexpr int apply(int vertex) const {return ((reflected ? rotation - vertex : rotation + vertex) % num_vertices + num_vertices) % num_vertices;}
+        constexpr Chord apply(Chord const& chord) const {return Chord(apply(chord.get_start()), apply(chord.get_end()), num_vertices);}
+        constexpr Dihedral inverse() const {return reflected ? *this : Dihedral(num_vertices, -rotation, false);}
+
+        // (a * b).apply(x) == a.apply(b.apply(x))
+        friend constexpr Dihedral operator*(Dihedral const& a, Dihedral const& b)
+        {return Dihedral(a.num_vertices, a.reflected ? a.rotation - b.rotation : a.rotation + b.rotation, a.reflected != b.reflected);}
+        friend constexpr bool operator==(Dihedral const& a, Dihedral const& b)
+        {return a.num_vertices == b.num_vertices && a.rotation == b.rotation && a.reflected == b.reflected;}
+        friend constexpr bool operator!=(Dihedral const& a, Dihedral const& b) {return !(a==b);}
+};
+
+
 class Span {
     private:
         int num_vertices;
@@ -88,31 +234,429 @@ class Span {
         Span();
         Span(int start, int end, int nvert);
 
+        int get_start() const {return start;}
+        int get_end() const {return end;}
+
         bool contains(int vertex) const;
         bool coincident(Span const& other) const;
 };
 
 
+// A graph number: one bit per possible chord, in the order Hamiltonian stores them, read as one big
+// unsigned integer with chord 0 as the least significant bit
+// Up to inline_words words (so up to 33 vertices) live inside the object, and only bigger ones use the heap
+// Comparison is numeric, which is the same order the canonical form is the maximum of
+class GraphNumber
+{
+    public:
+        using word_type = std::uint64_t;
+        static constexpr unsigned int word_bits = 8 * sizeof(word_type);
+        static constexpr unsigned int inline_words = 8;
+
+        GraphNumber() : num_words(0), inline_storage{} {}
+        // All zeros
+        explicit GraphNumber(unsigned int words);
+        GraphNumber(word_type const* words, unsigned int count);
+
+        // An all zero graph number with room for every chord on nvert vertices
+        static GraphNumber for_vertices(int nvert);
+
+        unsigned int size() const {return num_words;}
+        word_type* data() {return num_words > inline_words ? heap_storage.data() : inline_storage;}
+        word_type const* data() const {return num_words > inline_words ? heap_storage.data() : inline_storage;}
+        word_type operator[](unsigned int word) const {return data()[word];}
+        word_type& operator[](unsigned int word) {return data()[word];}
+
+        bool test(unsigned long int bit) const {return (data()[bit / word_bits] >> (bit % word_bits)) & 1;}
+        void set(unsigned long int bit) {data()[bit / word_bits] |= word_type(1) << (bit % word_bits);}
+        void reset(unsigned long int bit) {data()[bit / word_bits] &= ~(word_type(1) << (bit % word_bits));}
+        unsigned long int popcount() const;
+        std::size_t hash() const;
+        // Same thing for raw words
+        static std::size_t hash(word_type const* words, unsigned int count);
+
+        // Numbers of different lengths compare as if the shorter one had leading zeros
+        friend bool operator==(GraphNumber const& a, GraphNumber const& b) {return compare(a, b) == 0;}
+        friend bool operator!=(GraphNumber const& a, GraphNumber const& b) {return compare(a, b) != 0;}
+        friend bool operator<(GraphNumber const& a, GraphNumber const& b) {return compare(a, b) < 0;}
+        friend bool operator>(GraphNumber const& a, GraphNumber const& b) {return compare(a, b) > 0;}
+        friend bool operator<=(GraphNumber const& a, GraphNumber const& b) {return compare(a, b) <= 0;}
+        friend bool operator>=(GraphNumber const& a, GraphNumber const& b) {return compare(a, b) >= 0;}
+        // Negative, zero or positive, like strcmp. Vectorized when the CPU allows it
+        static int compare(GraphNumber const& a, GraphNumber const& b);
+        // Same thing for raw words of the same length
+        static int compare(word_type const* a, word_type const* b, unsigned int count);
+
+    private:
+        unsigned int num_words;
+        word_type inline_storage[inline_words];
+        std::vector<word_type> heap_storage;
+};
+
+namespace std {
+    template<>
+    struct hash<GraphNumber>
+    {
+        std::size_t operator() (GraphNumber const& num) const noexcept {return num.hash();}
+    };
+}
+
+
+// Counters and timers for the hot paths, so a long run can say where its time went
+// They're only compiled in with PANCYCLIC_INSTRUMENT defined (the PANCYCLIC_INSTRUMENT CMake option); otherwise the
+// macros below are empty and snapshots are all zeros
+// Each thread counts into its own block, which only it writes, so counting never contends. When a thread exits,
+// its block is added into a total for finished threads, and snapshot() adds that and the live blocks up
+// Phases can nest (get_crossing_components_map calls crossing_components), so their times are inclusive
+class Instrumentation
+{
+    public:
+        enum Phase
+        {
+            CANONICALIZE,
+            TRANSFORM,
+            COMPONENTS,
+            COMPONENT_MAP,
+            // Graph numbers, their digits, graph6 and sparse6
+            ENCODE,
+            DECODE,
+            NUM_PHASES
+        };
+        // Histograms have a bucket per count below this, and one for everything from here up
+        static constexpr int histogram_buckets = 1024;
+
+#ifdef PANCYCLIC_INSTRUMENT
+        static constexpr bool enabled = true;
+#else
+        static constexpr bool enabled = false;
+#endif
+
+        struct PhaseStats
+        {
+            unsigned long long int calls = 0;
+            unsigned long long int nanoseconds = 0;
+        };
+
+        struct Snapshot
+        {
+            PhaseStats phases[NUM_PHASES];
+            // Chord counts of the graphs canonicalized, and component counts of the graphs split into components
+            std::vector<unsigned long long int> chord_counts;
+            std::vector<unsigned long long int> component_counts;
+        };
+
+        static char const* phase_name(Phase phase);
+        static Snapshot snapshot();
+        // Zeroes every thread's counters. Counts made while this runs may or may not survive
+        static void reset();
+        // The snapshot as one JSON object, with only the non-empty histogram buckets
+        static void dump_json(std::ostream& out);
+        static std::string to_json();
+
+        static void record_chords(int chords) {update([chords](Block& block) {count(block.chord_counts, chords);});}
+        static void record_components(int comps) {update([comps](Block& block) {count(block.component_counts, comps);});}
+
+        class ScopedTimer
+        {
+            private:
+                Phase phase;
+                std::uint64_t begin;
+
+            public:
+                explicit ScopedTimer(Phase phase) : phase(phase), begin(ticks()) {}
+                ~ScopedTimer();
+                ScopedTimer(ScopedTimer const&) = delete;
+                ScopedTimer& operator=(ScopedTimer const&) = delete;
+        };
+
+    private:
+        // The clock is read twice per call, so it's the time stamp counter where there is one, since the
+        // steady clock can cost more than the shorter phases do. Ticks are turned into nanoseconds by
+        // comparing both clocks over the whole run
+        static std::uint64_t ticks()
+        {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            return __builtin_ia32_rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+        // Relaxed atomics, so snapshot() can read them while the owner keeps counting
+        struct Block
+        {
+            std::atomic<unsigned long long int> calls[NUM_PHASES];
+            std::atomic<unsigned long long int> ticks[NUM_PHASES];
+            std::atomic<unsigned long long int> chord_counts[histogram_buckets + 1];
+            std::atomic<unsigned long long int> component_counts[histogram_buckets + 1];
+
+            Block() {clear();}
+            void clear();
+            void add(Block const& other);
+        };
+        // The blocks of running threads. When a thread exits, its counts are added into retired and its block is
+        // freed, so pools that start new threads every run don't pile up blocks
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<Block>> blocks;
+            Block retired;
+            std::uint64_t start_ticks;
+            std::chrono::steady_clock::time_point start_time;
+
+            Registry() : start_ticks(Instrumentation::ticks()), start_time(std::chrono::steady_clock::now()) {}
+        };
+
+        // Retires the calling thread's block when the thread exits
+        struct ThreadBlock
+        {
+            Block* block = nullptr;
+            ~ThreadBlock();
+        };
+
+        // The calling thread's block, which is null until it first counts something, and again once it's retired
+        inline static thread_local Block* current = nullptr;
+        inline static thread_local bool retired_thread = false;
+
+        static Registry& registry();
+        static Block& new_thread_block();
+        static void update_retired(void (*update)(Block&, void const*), void const* context);
+        // Counts go into the thread's own block, except from code that runs in the thread's teardown after its
+        // block is gone (another thread_local's destructor, say), which adds straight to the retired total
+        template<typename Update>
+        static void update(Update const& update)
+        {
+            if (current) update(*current);
+            else if (!retired_thread) update(new_thread_block());
+            else update_retired([](Block& block, void const* context) {(*static_cast<Update const*>(context))(block);}, &update);
+        }
+        // Only the owning thread writes, so a plain load and store is enough
+        static void bump(std::atomic<unsigned long long int>& counter, unsigned long long int by=1)
+        {counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);}
+        static void count(std::atomic<unsigned long long int>* histogram, int value)
+        {bump(histogram[value < 0 ? 0 : value < histogram_buckets ? value : histogram_buckets]);}
+};
+
+#ifdef PANCYCLIC_INSTRUMENT
+#define PANCYCLIC_CONCAT_(a, b) a##b
+#define PANCYCLIC_CONCAT(a, b) PANCYCLIC_CONCAT_(a, b)
+// Times the rest of the enclosing scope as one call of the phase
+#define PANCYCLIC_TIME(phase) Instrumentation::ScopedTimer PANCYCLIC_CONCAT(pancyclic_timer_, __LINE__)(Instrumentation::phase)
+#define PANCYCLIC_RECORD_CHORDS(chords) Instrumentation::record_chords(chords)
+#define PANCYCLIC_RECORD_COMPONENTS(comps) Instrumentation::record_components(comps)
+#else
+#define PANCYCLIC_TIME(phase) ((void)0)
+#define PANCYCLIC_RECORD_CHORDS(chords) ((void)0)
+#define PANCYCLIC_RECORD_COMPONENTS(comps) ((void)0)
+#endif
+
+
+class Hamiltonian;
+
+// The crossing components of a Hamiltonian, without a Hamiltonian per component
+// All the chords live in one vector grouped by component, and component c is grouped[offsets[c] .. offsets[c+1])
+// Chords within a component are sorted
+class CrossingComponents
+{
+    public:
+        using const_iterator = std::vector<Chord>::const_iterator;
+
+        // The chords of one component, as a plain range into the grouped vector
+        struct Component
+        {
+            const_iterator first;
+            const_iterator last;
+
+            const_iterator begin() const {return first;}
+            const_iterator end() const {return last;}
+            std::size_t size() const {return last - first;}
+            Chord const& operator[](std::size_t idx) const {return first[idx];}
+        };
+
+        CrossingComponents() : num_vertices(0), offsets(1, 0) {}
+
+        int get_num_vertices() const {return num_vertices;}
+        // Number of components
+        std::size_t size() const {return offsets.size() - 1;}
+        bool empty() const {return size() == 0;}
+        Component operator[](std::size_t comp) const {return {grouped.begin() + offsets[comp], grouped.begin() + offsets[comp + 1]};}
+        std::vector<Chord> const& get_grouped_chords() const {return grouped;}
+        std::vector<unsigned int> const& get_offsets() const {return offsets;}
+
+        // For code that still wants a Hamiltonian per component
+        Hamiltonian to_hamiltonian(std::size_t comp) const;
+        std::vector<Hamiltonian> to_hamiltonians() const;
+
+    private:
+        int num_vertices;
+        std::vector<Chord> grouped;
+        std::vector<unsigned int> offsets;
+
+        // Working memory for Hamiltonian::crossing_components, kept here so refilling doesn't allocate
+        struct Scratch
+        {
+            std::vector<Chord> chords;
+            std::vector<int> rank;
+            std::vector<int> parent;
+            std::vector<int> end_offsets;
+            std::vector<int> ends_at;
+            std::vector<int> fill;
+            std::vector<int> open;
+            std::vector<int> blocks;
+            std::vector<unsigned int> sizes;
+        } scratch;
+
+        friend class Hamiltonian;
+};
+
+
+// How the crossing components of a Hamiltonian sit inside each other
+// Different components never cross, so each one lies in a single span of any other: the arc between two of that
+// component's endpoints that are next to each other going round the cycle. Span i of a component runs from its
+// i'th lowest endpoint to the next one up, and its last span wraps round through vertex 0 back to the lowest
+// A component's parent is the innermost component it's in a non-wrapping span of, and components that aren't in
+// any (the ones next to the cycle edge (n-1, 0)) are at the top level
+// Building it is one sweep round the cycle to collect endpoints, a sort of the components by their lowest and
+// highest endpoints, and one pass with a stack, so it's O(n + k log k) for k components instead of checking
+// every pair of spans with Span::coincident
+class ComponentTree
+{
+    public:
+        // The parent of a top level component
+        static constexpr int top = -1;
+
+        // Component indices, in order of their lowest endpoint
+        struct Children
+        {
+            int const* first;
+            int const* last;
+
+            int const* begin() const {return first;}
+            int const* end() const {return last;}
+            std::size_t size() const {return last - first;}
+            int operator[](std::size_t idx) const {return first[idx];}
+        };
+
+        ComponentTree() : num_vertices(0), child_offsets(2, 0) {}
+        explicit ComponentTree(CrossingComponents const& comps) : ComponentTree() {build(comps);}
+        explicit ComponentTree(std::vector<Hamiltonian> const& comps) : ComponentTree() {build(comps);}
+
+        // Both refill the tree, reusing its memory. Component indices are the same as in comps
+        // If the components cross each other, what comes out is meaningless
+        void build(CrossingComponents const& comps);
+        void build(std::vector<Hamiltonian> const& comps);
+
+        int get_num_vertices() const {return num_vertices;}
+        // Number of components
+        std::size_t size() const {return parents.size();}
+
+        int parent(std::size_t comp) const {return parents[comp];}
+        // Which of the parent's spans the component is in
+        int parent_span(std::size_t comp) const {return parent_spans[comp];}
+        Children children(int comp) const;
+        Children top_level() const {return children(top);}
+        // Number of parents above the component, so top level components have depth 0
+        int depth(std::size_t comp) const;
+
+        // A component's distinct endpoints, lowest first. It has as many spans as endpoints
+        std::size_t num_endpoints(std::size_t comp) const {return endpoint_offsets[comp + 1] - endpoint_offsets[comp];}
+        int endpoint(std::size_t comp, std::size_t idx) const {return endpoints[endpoint_offsets[comp] + idx];}
+        Span get_span(std::size_t comp, std::size_t span) const;
+        std::vector<Span> spans(std::size_t comp) const;
+
+    private:
+        int num_vertices;
+        std::vector<int> parents;
+        std::vector<int> parent_spans;
+        std::vector<int> endpoints;
+        std::vector<unsigned int> endpoint_offsets;
+        // Children of component c are children_of[child_offsets[c + 1] .. child_offsets[c + 2]), and the top
+        // level ones are at the front
+        std::vector<int> children_of;
+        std::vector<unsigned int> child_offsets;
+
+        // Working memory, kept so rebuilding doesn't allocate
+        struct Scratch
+        {
+            std::vector<int> chord_comps;
+            std::vector<int> chord_ends;
+            std::vector<unsigned int> vertex_offsets;
+            std::vector<int> touching;
+            std::vector<int> last_seen;
+            std::vector<int> order;
+            std::vector<int> stack;
+        } scratch;
+
+        // Calls for_each_chord(add(Chord const&, int comp)) to get the chords
+        template<typename ForEachChord>
+        void build(int nvert, std::size_t num_comps, ForEachChord for_each_chord);
+};
+
+
 class Hamiltonian
 {
-    using inner_AL_type = std::unordered_set<int>;
-    using outer_AL_type = std::unordered_map<int, inner_AL_type>;
-    using inner_AL_iter = decltype(std::declval<inner_AL_type>().cbegin());
-    using outer_AL_iter = decltype(std::declval<outer_AL_type>().cbegin());
-    
+    // The chords are stored as one bit per possible chord, in the same order as the graph number
+    // That way copying a graph is just copying a few words, and the graph number is basically free
+    using word_type = std::uint64_t;
+    static constexpr unsigned int word_bits = 8 * sizeof(word_type);
 
     private:
         int num_vertices;
         int num_chords;
-        outer_AL_type chords_al;
+        std::vector<word_type> chord_bits;
+
+        // Crossing components kept up to date by add_chord, when track_crossing_components() is on
+        // Everything is indexed by chord bit, and all of it stays empty while tracking is off
+        struct ComponentTracker
+        {
+            bool enabled = false;
+            // Disjoint set storage for boost::disjoint_sets
+            std::vector<int> rank;
+            std::vector<int> parent;
+            // Each component's chords form a circular list through next, so merging two components is a swap
+            std::vector<int> next;
+            // Current roots, and where each root sits in roots, so roots can be dropped in O(1)
+            std::vector<int> roots;
+            std::vector<int> root_pos;
+            // Bit w of row v is set if there's a chord between v and w
+            unsigned int row_words = 0;
+            std::vector<word_type> adjacency;
+        } tracker;
+
+        void reset_tracker();
+        void track_chord(unsigned long int idx, int start, int end);
+        // Starts the tracker over from the chords already in the graph
+        void rebuild_tracker();
+
+        // Cycle lengths kept up to date by add_chord, when track_cycle_lengths() is on (up to 64 vertices)
+        struct CycleTracker
+        {
+            bool enabled = false;
+            // Bit L-1 is set if there's a cycle of length L
+            std::uint64_t lengths = 0;
+            // Bit w of adjacency[v] is set if v and w are joined, by a chord or the cycle
+            std::vector<std::uint64_t> adjacency;
+            // The chord bit and the lengths from before it, for every chord added since the last rebuild
+            std::vector<std::pair<unsigned long int, std::uint64_t>> undo;
+        } cycle_tracker;
 
-        void reset_al();
-        std::unordered_map<int, Hamiltonian*> get_crossing_comp_hamil_map() const;
+        void track_cycles(unsigned long int idx, int start, int end);
+        // Starts over from the chords already in the graph. Moving the graph by a group element can't change
+        // its cycle lengths, so that only has to redo the adjacency
+        void rebuild_cycle_tracker(bool same_lengths=false);
+
+        void reset_chords();
+        // Same as Chord::index, but throws if the chord can't be in this graph
+        unsigned long int checked_chord_bit(Chord const& chord) const;
+        bool has_chord_bit(unsigned long int idx) const {return (chord_bits[idx / word_bits] >> (idx % word_bits)) & 1;}
+        // Unions every pair of crossing chords in scratch.chords (which has to be sorted)
+        // Afterwards scratch.parent[i] is the root of chord i's component
+        void union_crossing_chords(CrossingComponents::Scratch& scratch) const;
 
     public:
         Hamiltonian();
         Hamiltonian(int nvert);
-        Hamiltonian(int nvert, std::vector<short> const& graph_num);
+        Hamiltonian(int nvert, GraphNumber const& graph_num);
         // Implement this constructor as a factory method because template constructor is not possible
         // Also have to put implementation in header since it's a nonspecialized template
         // TODO: How to guarantee Iter iterates over chords?
@@ -135,62 +679,1336 @@ class Hamiltonian
             public:
                 ChordsRange(Hamiltonian const* theHamil) : hamil(theHamil) {};
 
+                // Walks the set chord bits in graph number order, so chords come out sorted by start then end
+                // The current chord is kept by value, so iterating never touches the heap
                 class ChordsALIterator
                 {
-                    using iterator_category = std::input_iterator_tag;
-                    using difference_type = std::ptrdiff_t;
-                    using value_type = Chord;
-                    using pointer = Chord*;
-                    using referece = Chord&;
+                    public:
+                        using iterator_category = std::forward_iterator_tag;
+                        using difference_type = std::ptrdiff_t;
+                        using value_type = Chord;
+                        using pointer = Chord const*;
+                        using reference = Chord const&;
 
                     private:
-                        pointer curr_chord;
-                        outer_AL_type const* const outer;
-                        std::unordered_set<int> const* inner;
-                        outer_AL_iter outer_iter;
-                        inner_AL_iter inner_iter;
-
-                        void reset_inner();
-                        void update_chord();
+                        Chord curr_chord;
+                        Hamiltonian const* hamil;
+                        unsigned long int idx;
+                        unsigned long int next_row;
+
                         void seek_chord();
 
                     public:
-                        ChordsALIterator(Hamiltonian const* hamil, bool end=false);
-                        ~ChordsALIterator();
-                        value_type operator*();
-                        pointer operator->();
+                        ChordsALIterator() : hamil(nullptr), idx(0), next_row(0) {}
+                        ChordsALIterator(Hamiltonian const* theHamil, bool end=false);
+                        reference operator*() const {return curr_chord;}
+                        pointer operator->() const {return &curr_chord;}
                         ChordsALIterator& operator++();
                         ChordsALIterator operator++(int);
 
                         friend bool operator==(ChordsALIterator const& a, ChordsALIterator const& b);
                         friend bool operator!=(ChordsALIterator const& a, ChordsALIterator const& b) {return !(a==b);};
                 };
+                using iterator = ChordsALIterator;
+                using const_iterator = ChordsALIterator;
 
                 ChordsALIterator begin() const;
                 ChordsALIterator end() const;
+                std::size_t size() const {return hamil->get_num_chords();}
+                bool empty() const {return size() == 0;}
         };
         ChordsRange chords() const;
+        // The chords in the same order as chords(), but in contiguous storage for random access (and std::execution)
+        // The second one reuses out's memory
+        std::vector<Chord> chord_vector() const;
+        void chord_vector(std::vector<Chord>& out) const;
 
+        // Refills out, reusing its memory, so a worker that keeps one around doesn't allocate once it's warmed up
+        void crossing_components(CrossingComponents& out) const;
+        CrossingComponents crossing_components() const;
+        // These two build a whole Hamiltonian per component, so they're slower than crossing_components()
         std::vector<Hamiltonian> get_crossing_components() const;
-        std::unordered_map<Chord, Hamiltonian*> get_crossing_components_map() const;
+        // Indexed by Chord::index(): every chord maps to the component it's in, and chords in the same component share it
+        // Chords not in the graph map to null
+        std::vector<std::shared_ptr<Hamiltonian>> get_crossing_components_map() const;
+
+        // While this is on, add_chord keeps the crossing components up to date, so asking for them
+        // doesn't recompute anything. A new chord is only checked against chords with exactly one
+        // endpoint strictly inside it, since those are the only ones it can cross
+        // Disjoint sets can't split, so remove_chord (and rotate/reflect) rebuild them from scratch
+        void track_crossing_components(bool track=true);
+        bool tracking_crossing_components() const {return tracker.enabled;}
+        int get_num_crossing_components() const;
 
-        // I use vectors of shorts to emulate arbitrary length nums
-        // This is important because the number of bits is equal to the number of possible chords
-        // So even a long int would only support a hamiltonian of degree up to 12
-        std::vector<short> get_graph_num() const;
-        std::vector<short> get_graph_iso_num() const;
-        static std::string get_graph_num_digs(int nverts, std::vector<short> graph_num);
+        // The number of bits is equal to the number of possible chords, so even a long int would only
+        // support a hamiltonian of degree up to 12. See GraphNumber
+        GraphNumber get_graph_num() const;
+        GraphNumber get_graph_iso_num() const;
+        static std::string get_graph_num_digs(int nverts, GraphNumber const& graph_num);
 
-        // TODO: Check chord num verts
         void add_chord(Chord const& c);
+        void remove_chord(Chord const& c);
+        bool has_chord(Chord const& c) const;
+        // Removes every chord, keeping the memory
+        void clear() {reset_chords();}
 
-        void chord_based_transform(std::function<Chord(Chord)> transform);
+        // Replaces every chord c with transform(c). Chords that land on the same chord merge
+        template<typename Transform>
+        void chord_based_transform(Transform transform);
+        // Moves the chords by a group element, as a permutation of the chord bits, without allocating once warmed up
+        void transform(Dihedral const& element);
         void rotate(int rotation);
         void rotate();
         void reflect(int vertex);
         void reflect();
+        // Calls visit(Dihedral const&, Hamiltonian const&) with every group element and the graph it moves this one to
+        // Every image comes straight from this graph, and the same Hamiltonian is reused for all of them
+        template<typename Visitor>
+        void for_each_image(Visitor visit) const;
 
         std::string describe(bool w_graph_num=true, bool w_graph_iso_num=true) const;
+        // Replaces the graph with its canonical form, i.e. the one get_graph_iso_num() is the graph number of
+        void canonicalize();
+
+        // graph6 and sparse6, as used by nauty and friends, with the Hamiltonian cycle 0, 1, ..., n-1 written
+        // out as ordinary edges. Parsing throws if any cycle edge is missing, since it's what vertex order means here
+        // The to_ versions append to out, and the from_ versions refill out (which only allocates if n changed),
+        // so converting lots of graphs with the same buffers doesn't touch the heap
+        void to_graph6(std::string& out) const;
+        void to_sparse6(std::string& out) const;
+        std::string to_graph6() const;
+        std::string to_sparse6() const;
+        static void from_graph6(char const* first, char const* last, Hamiltonian& out);
+        static void from_sparse6(char const* first, char const* last, Hamiltonian& out);
+        static Hamiltonian from_graph6(std::string const& text);
+        static Hamiltonian from_sparse6(std::string const& text);
+
+        // Bit L is set if there's a cycle of length L (so bits 0 to 2 are never set)
+        // Only supports up to 64 vertices
+        boost::dynamic_bitset<> cycle_length_spectrum() const;
+        // Same thing as one word, but with length L in bit L-1 so 64 vertices still fit
+        std::uint64_t get_cycle_lengths() const;
+        // Every length from 3 to nvert, laid out the same way, i.e. what get_cycle_lengths gives for a pancyclic graph
+        static std::uint64_t all_cycle_lengths(int nvert);
+
+        // While this is on, add_chord keeps the cycle lengths up to date. Every cycle the new chord (s, e) makes
+        // goes through it, so only the lengths still missing are looked for, among the paths from e back to s
+        // Removing the chord added most recently puts the old lengths back without searching, so a backtracking
+        // search gets undo for free. Removing any other chord (or clear) starts over from scratch
+        void track_cycle_lengths(bool track=true);
+        bool tracking_cycle_lengths() const {return cycle_tracker.enabled;}
+        // Whether there's a cycle of every length from 3 to the number of vertices
+        bool is_pancyclic() const;
+
+        friend class Canonicalizer;
+        template<int> friend class FixedHamiltonian;
+};
+
+
+// Formats convert_graphs can write. GRAPH_NUM_DIGS is get_graph_num_digs, one character per chord
+enum GraphFormat
+{
+    GRAPH6,
+    SPARSE6,
+    GRAPH_NUM_DIGS
+};
+
+// Reads one graph per line in any of the GraphFormats (sparse6 lines start with ':', graph number digits are all
+// 0s and 1s, and anything else is graph6), and writes each one back out in format, canonicalized first if asked
+// Buffers are reused the whole way through, so the only allocations are when n changes
+// Returns the number of graphs converted
+unsigned long long int convert_graphs(std::istream& in, std::ostream& out, GraphFormat format, bool canonical=false);
+
+
+// Finds the canonical graph number of a Hamiltonian under the dihedral group of its cycle
+// The canonical graph number is the largest graph number in the orbit, reading the graph number as
+// one big unsigned integer (chord 0 is the least significant bit)
+// Instead of rebuilding the graph for every rotation and reflection, each group element is stored as a
+// permutation of chord indices, and candidates are compared a word at a time from the top, bailing out
+// as soon as they lose
+// Sparse graphs mostly tie on their empty top words, so for those the chords are scattered instead
+class Canonicalizer
+{
+    public:
+        using word_type = std::uint64_t;
+        static constexpr unsigned int word_bits = 8 * sizeof(word_type);
+
+        Canonicalizer(int nvert);
+
+        // Tables are built once per number of vertices and shared between threads
+        static Canonicalizer const& for_vertices(int nvert);
+
+        int get_num_vertices() const {return num_vertices;}
+        unsigned int get_num_words() const {return num_words;}
+        // Group elements 0 .. n-1 are rotations by that many vertices
+        // Elements n .. 2n-1 are reflect() followed by a rotation by (element - n)
+        int get_group_order() const {return 2 * num_vertices;}
+
+        // words and out are both get_num_words() long, and may not alias
+        // Returns the group element that moves words onto out (the first one, if there are several)
+        int canonical_form(word_type const* words, word_type* out) const;
+        bool is_canonical(word_type const* words) const;
+
+        int canonical_form(Hamiltonian const& graph, word_type* out) const {return canonical_form(graph.chord_bits.data(), out);}
+        bool is_canonical(Hamiltonian const& graph) const {return is_canonical(graph.chord_bits.data());}
+        // These two throw if num isn't exactly get_num_words() words
+        GraphNumber canonical_form(GraphNumber const& num) const;
+        bool is_canonical(GraphNumber const& num) const;
+
+        // Writes the words moved by a group element into out. words and out may not alias
+        void transform(int element, word_type const* words, word_type* out) const;
+
+    private:
+        int num_vertices;
+        unsigned long int num_chords;
+        unsigned int num_words;
+        // preimage[element * num_chords + idx] is the chord that the element moves onto chord idx
+        // Storing the inverse lets a candidate be built a word at a time, starting from the top
+        std::vector<std::uint32_t> preimage;
+        // image[element * num_chords + idx] is where the element moves chord idx
+        std::vector<std::uint32_t> image;
+
+        // Below this many chords, scattering the chords beats gathering every bit
+        bool use_scatter(unsigned long int graph_chords) const {return graph_chords < word_bits;}
+        // Writes the graph's chords into set_chords and returns how many there are
+        unsigned long int list_chords(word_type const* words, std::uint32_t* set_chords) const;
+        void scatter(std::uint32_t const* perm, std::uint32_t const* set_chords, unsigned long int count, word_type* out) const;
+        word_type image_word(std::uint32_t const* perm, word_type const* words, unsigned int word) const;
+};
+
+
+// Remembers the canonical forms of graphs it's seen, keyed by their raw graph number, along with the group
+// element that takes each one to its canonical form. Worth it when the same graphs keep coming back, like the
+// small components get_crossing_components() splits graphs into
+// It holds capacity graphs (rounded up to a multiple of the number of shards), and when it's full it throws one
+// out with the CLOCK algorithm: a hand sweeps round the entries, skipping (and clearing the flag of) any that
+// were used since it last went past
+// Entries are split into shards that each have their own lock, and canonical forms are worked out outside the lock
+class CanonicalCache
+{
+    public:
+        using word_type = GraphNumber::word_type;
+
+        // num_shards <= 0 means a few per core
+        CanonicalCache(int nvert, std::size_t capacity, int num_shards=0);
+        CanonicalCache(CanonicalCache const&) = delete;
+        CanonicalCache& operator=(CanonicalCache const&) = delete;
+
+        int get_num_vertices() const {return num_vertices;}
+        std::size_t get_capacity() const {return capacity.load(std::memory_order_relaxed);}
+        // Empties the cache too
+        void set_capacity(std::size_t capacity);
+
+        // Same as Canonicalizer::canonical_form, but from the cache when it can be
+        int canonical_form(word_type const* words, word_type* out);
+        GraphNumber canonical_form(GraphNumber const& num, Dihedral* element=nullptr);
+
+        std::size_t size() const;
+        unsigned long long int hits() const;
+        unsigned long long int misses() const;
+        // Drops every entry and zeroes the counters
+        void clear();
+
+        // While this is on, Hamiltonian::get_graph_iso_num and canonicalize go through a cache per number of
+        // vertices, each holding up to capacity graphs. Turning it off (capacity 0) or changing the capacity
+        // empties them
+        static void set_global_capacity(std::size_t capacity);
+        // The cache get_graph_iso_num uses for this many vertices, or null if it's off
+        static CanonicalCache* global(int nvert);
+
+    private:
+        struct alignas(64) Shard
+        {
+            std::mutex mutex;
+            // Entry e's raw and canonical words are at e * num_words in these
+            std::vector<word_type> raw;
+            std::vector<word_type> canonical;
+            std::vector<std::size_t> hashes;
+            std::vector<std::int32_t> elements;
+            // 0 for an empty entry, 1 for one that's there, 2 for one that's been used since the hand went past
+            std::vector<std::uint8_t> states;
+            // Open addressing index from hash to entry + 1 (0 is empty), twice as big as the number of entries
+            std::vector<std::uint32_t> index;
+            std::size_t hand = 0;
+            std::size_t count = 0;
+            unsigned long long int hits = 0;
+            unsigned long long int misses = 0;
+        };
+
+        int num_vertices;
+        unsigned int num_words;
+        std::atomic<std::size_t> capacity;
+        Canonicalizer const* canon;
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        // Index slot holding the entry with these words, or the empty slot where it would go
+        std::size_t find_slot(Shard const& shard, std::size_t hash, word_type const* words) const;
+        void erase_slot(Shard& shard, std::size_t slot) const;
+        // Takes the next entry from the clock hand, throwing out whatever was there
+        std::size_t evict(Shard& shard) const;
+        void reset(Shard& shard, std::size_t entries) const;
+        std::size_t entries_per_shard(std::size_t capacity) const {return (capacity + shards.size() - 1) / shards.size();}
+};
+
+template<typename Transform>
+void Hamiltonian::chord_based_transform(Transform transform)
+{
+    PANCYCLIC_TIME(TRANSFORM);
+    // Build the new bits on the side, since chords can move onto bits that haven't been read yet
+    GraphNumber moved(chord_bits.size());
+    for (Chord const& chord : chords()) moved.set(checked_chord_bit(transform(chord)));
+
+    std::copy(moved.data(), moved.data() + moved.size(), chord_bits.begin());
+    num_chords = moved.popcount();
+    if (tracker.enabled) rebuild_tracker();
+    if (cycle_tracker.enabled) rebuild_cycle_tracker();
+}
+
+template<typename Visitor>
+void Hamiltonian::for_each_image(Visitor visit) const
+{
+    Canonicalizer const& canon = Canonicalizer::for_vertices(num_vertices);
+    Hamiltonian image(num_vertices);
+    image.num_chords = num_chords;
+    for (int element = 0; element < canon.get_group_order(); element++)
+    {
+        canon.transform(element, chord_bits.data(), image.chord_bits.data());
+        visit(static_cast<Dihedral const&>(Dihedral(num_vertices, element)), static_cast<Hamiltonian const&>(image));
+    }
+}
+
+
+// Chord tables for FixedHamiltonian<N>, all worked out at compile time
+// Chord indices are the same as Hamiltonian's chord bits, and group elements are numbered like Canonicalizer's
+template<int N>
+struct FixedChordTables
+{
+    static constexpr unsigned int num_chords = N * (N - 3) / 2;
+    static constexpr unsigned int num_words = (num_chords + 63) / 64;
+    static constexpr int group_order = 2 * N;
+
+    std::array<std::uint8_t, num_chords> starts;
+    std::array<std::uint8_t, num_chords> ends;
+    // image[element][idx] is where the element moves chord idx, and preimage is the other way around
+    std::array<std::array<std::uint16_t, num_chords>, group_order> image;
+    std::array<std::array<std::uint16_t, num_chords>, group_order> preimage;
+    // Bit j of crossing[i] is set if chords i and j cross
+    std::array<std::array<std::uint64_t, num_words>, num_chords> crossing;
+
+    constexpr FixedChordTables() : starts(), ends(), image(), preimage(), crossing()
+    {
+        unsigned int idx = 0;
+        for (int start = 0; start < N - 2; start++)
+        {
+            for (int end = start+2; end < N - (start ? 0 : 1); end++, idx++)
+            {
+                starts[idx] = start;
+                ends[idx] = end;
+            }
+        }
+
+        for (int element = 0; element < group_order; element++)
+        {
+            for (idx = 0; idx < num_chords; idx++)
+            {
+                // Same as Chord::reflect() then Chord::rotate(), without the Chord
+                int start = starts[idx], end = ends[idx];
+                if (element >= N)
+                {
+                    start = (N - start) % N;
+                    end = (N - end) % N;
+                }
+                start = (start + element) % N;
+                end = (end + element) % N;
+                if (end < start)
+                {
+                    int const tmp = start;
+                    start = end;
+                    end = tmp;
+                }
+                image[element][idx] = Chord::index(start, end, N);
+                preimage[element][Chord::index(start, end, N)] = idx;
+            }
+        }
+
+        for (unsigned int a = 0; a < num_chords; a++)
+        {
+            for (unsigned int b = 0; b < num_chords; b++)
+            {
+                bool const cross = (starts[a] < starts[b] && starts[b] < ends[a] && ends[a] < ends[b]) ||
+                                   (starts[b] < starts[a] && starts[a] < ends[b] && ends[b] < ends[a]);
+                if (cross) crossing[a][b / 64] |= std::uint64_t(1) << (b % 64);
+            }
+        }
+    }
+};
+
+// A Hamiltonian with the number of vertices fixed at compile time, for the small n most of the work happens at
+// The chords are a std::array of words, and rotations, reflections, canonical forms and crossings all run off
+// constexpr tables, so with the loop bounds known they unroll into plain bit operations
+// Converting to and from Hamiltonian is a copy of a few words
+template<int N>
+class FixedHamiltonian
+{
+    static_assert(N >= 4 && N <= 255, "FixedHamiltonian needs between 4 and 255 vertices");
+
+    public:
+        using word_type = std::uint64_t;
+        static constexpr unsigned int word_bits = 8 * sizeof(word_type);
+        static constexpr int num_vertices = N;
+        static constexpr unsigned int max_num_chords = FixedChordTables<N>::num_chords;
+        static constexpr unsigned int num_words = FixedChordTables<N>::num_words;
+        static constexpr int group_order = FixedChordTables<N>::group_order;
+        using words_type = std::array<word_type, num_words>;
+
+    private:
+        static constexpr FixedChordTables<N> tables{};
+        words_type chord_bits;
+
+        static unsigned int checked_chord_bit(Chord const& chord)
+        {
+            if (chord.get_num_vertices() != N)
+                throw std::invalid_argument("Chord has a different number of vertices than the graph");
+            if (chord.get_end() - chord.get_start() < 2 || (chord.get_start() == 0 && chord.get_end() == N - 1))
+                throw std::invalid_argument("Chord is an edge of the Hamiltonian cycle");
+            return chord.index();
+        }
+
+        // True if a is bigger than b, reading both as numbers
+        static bool greater(words_type const& a, words_type const& b)
+        {
+            for (unsigned int word = num_words; word-- > 0;)
+            {
+                if (a[word] != b[word]) return a[word] > b[word];
+            }
+            return false;
+        }
+
+        // One word of transformed(element), pulled in through the preimage
+        word_type transformed_word(int element, unsigned int word) const
+        {
+            unsigned int const first = word * word_bits;
+            unsigned int const last = first + word_bits < max_num_chords ? first + word_bits : max_num_chords;
+            word_type ret = 0;
+            for (unsigned int idx = first; idx < last; idx++)
+            {
+                unsigned int const src = tables.preimage[element][idx];
+                ret |= ((chord_bits[src / word_bits] >> (src % word_bits)) & 1) << (idx - first);
+            }
+            return ret;
+        }
+
+        // Same split as Canonicalizer: sparse graphs scatter their chords, dense ones are gathered a word at a
+        // time from the top and drop out as soon as they lose to best
+        // Returns whether the element beat best, and if it did, best is now the element's image
+        bool improve(int element, words_type& best, bool sparse) const
+        {
+            if (sparse)
+            {
+                words_type const candidate = transformed(element);
+                if (!greater(candidate, best)) return false;
+                best = candidate;
+                return true;
+            }
+            for (unsigned int word = num_words; word-- > 0;)
+            {
+                word_type const candidate = transformed_word(element, word);
+                if (candidate < best[word]) return false;
+                if (candidate > best[word])
+                {
+                    best[word] = candidate;
+                    while (word-- > 0) best[word] = transformed_word(element, word);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    public:
+        FixedHamiltonian() : chord_bits() {}
+        explicit FixedHamiltonian(words_type const& words) : chord_bits(words) {}
+        explicit FixedHamiltonian(Hamiltonian const& graph)
+        {
+            if (graph.num_vertices != N)
+                throw std::invalid_argument("Hamiltonian has a different number of vertices than FixedHamiltonian");
+            std::copy(graph.chord_bits.begin(), graph.chord_bits.end(), chord_bits.begin());
+        }
+
+        Hamiltonian to_hamiltonian() const
+        {
+            Hamiltonian ret(N);
+            std::copy(chord_bits.begin(), chord_bits.end(), ret.chord_bits.begin());
+            ret.num_chords = get_num_chords();
+            return ret;
+        }
+
+        static constexpr int get_num_vertices() {return N;}
+        int get_num_chords() const
+        {
+            int count = 0;
+            for (word_type word : chord_bits) count += __builtin_popcountll(word);
+            return count;
+        }
+        words_type const& get_words() const {return chord_bits;}
+
+        static constexpr Chord chord_at_bit(unsigned int idx) {return Chord(tables.starts[idx], tables.ends[idx], N);}
+        bool has_chord_bit(unsigned int idx) const {return (chord_bits[idx / word_bits] >> (idx % word_bits)) & 1;}
+        void add_chord(Chord const& chord) {auto const idx = checked_chord_bit(chord); chord_bits[idx / word_bits] |= word_type(1) << (idx % word_bits);}
+        void remove_chord(Chord const& chord) {auto const idx = checked_chord_bit(chord); chord_bits[idx / word_bits] &= ~(word_type(1) << (idx % word_bits));}
+        bool has_chord(Chord const& chord) const {return has_chord_bit(checked_chord_bit(chord));}
+
+        GraphNumber get_graph_num() const {return GraphNumber(chord_bits.data(), num_words);}
+
+        // Group elements are numbered like Canonicalizer's
+        words_type transformed(int element) const
+        {
+            words_type out{};
+            for (unsigned int word = 0; word < num_words; word++)
+            {
+                for (word_type bits = chord_bits[word]; bits; bits &= bits - 1)
+                {
+                    unsigned int const dst = tables.image[element][word * word_bits + __builtin_ctzll(bits)];
+                    out[dst / word_bits] |= word_type(1) << (dst % word_bits);
+                }
+            }
+            return out;
+        }
+        void transform(int element) {chord_bits = transformed(element);}
+        void transform(Dihedral const& element) {transform(element.get_element());}
+        void rotate(int rotation) {transform(((rotation % N) + N) % N);}
+        void rotate() {rotate(1);}
+        // Reflecting about vertex is reflecting about 0 and then rotating by twice vertex
+        void reflect(int vertex) {transform(N + ((2 * vertex) % N + N) % N);}
+        void reflect() {reflect(0);}
+
+        // Same canonical form as Canonicalizer, i.e. the biggest graph number in the orbit
+        words_type canonical_words() const
+        {
+            bool const sparse = get_num_chords() < static_cast<int>(word_bits);
+            words_type best = chord_bits;
+            for (int element = 1; element < group_order; element++) improve(element, best, sparse);
+            return best;
+        }
+        GraphNumber get_graph_iso_num() const
+        {
+            words_type const canon = canonical_words();
+            return GraphNumber(canon.data(), num_words);
+        }
+        bool is_canonical() const
+        {
+            bool const sparse = get_num_chords() < static_cast<int>(word_bits);
+            words_type best = chord_bits;
+            for (int element = 1; element < group_order; element++)
+            {
+                if (improve(element, best, sparse)) return false;
+            }
+            return true;
+        }
+
+        static constexpr bool crossing(unsigned int a, unsigned int b) {return (tables.crossing[a][b / word_bits] >> (b % word_bits)) & 1;}
+        // The chords of this graph that cross chord idx
+        words_type crossing_chords(unsigned int idx) const
+        {
+            words_type out;
+            for (unsigned int word = 0; word < num_words; word++) out[word] = chord_bits[word] & tables.crossing[idx][word];
+            return out;
+        }
+        // Floods each component through the crossing table, a word at a time
+        int get_num_crossing_components() const
+        {
+            words_type left = chord_bits;
+            int count = 0;
+            for (unsigned int first = 0; first < num_words; first++)
+            {
+                while (left[first])
+                {
+                    words_type todo{};
+                    todo[first] = left[first] & -left[first];
+                    left[first] &= left[first] - 1;
+                    for (unsigned int word = first; word < num_words;)
+                    {
+                        if (!todo[word])
+                        {
+                            word++;
+                            continue;
+                        }
+                        unsigned int const idx = word * word_bits + __builtin_ctzll(todo[word]);
+                        todo[word] &= todo[word] - 1;
+                        unsigned int lowest = word;
+                        for (unsigned int other = 0; other < num_words; other++)
+                        {
+                            word_type const reached = tables.crossing[idx][other] & left[other];
+                            left[other] &= ~reached;
+                            todo[other] |= reached;
+                            if (reached && other < lowest) lowest = other;
+                        }
+                        word = lowest;
+                    }
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        friend bool operator==(FixedHamiltonian const& a, FixedHamiltonian const& b) {return a.chord_bits == b.chord_bits;}
+        friend bool operator!=(FixedHamiltonian const& a, FixedHamiltonian const& b) {return !(a==b);}
+};
+
+// Vertex counts with a FixedHamiltonian specialization behind visit_fixed
+constexpr int min_fixed_vertices = 4;
+constexpr int max_fixed_vertices = 24;
+
+// Calls visit(FixedHamiltonian<N> const&) if graph has N vertices for some N in [min_fixed_vertices, max_fixed_vertices],
+// and visit(graph) otherwise, so visit is usually a generic lambda
+template<typename Visitor, int N=min_fixed_vertices>
+auto visit_fixed(Hamiltonian const& graph, Visitor&& visit) -> decltype(visit(graph))
+{
+    if constexpr (N > max_fixed_vertices) return visit(graph);
+    else
+    {
+        if (graph.get_num_vertices() == N) return visit(static_cast<FixedHamiltonian<N> const&>(FixedHamiltonian<N>(graph)));
+        return visit_fixed<Visitor, N + 1>(graph, std::forward<Visitor>(visit));
+    }
+}
+
+
+
+// Runs tasks on a fixed set of threads, each with its own deque
+// Threads push and pop at the back of their own deque, and steal from the front of someone else's when they run
+// dry, so the big subtrees near the root are the ones that get stolen. Threads with nothing to steal sleep until
+// there's something new, so an irregular search doesn't keep every core spinning
+// A pool can run any number of times, one run at a time
+template<typename Task>
+class WorkStealingPool
+{
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        int num_threads;
+        // Queues hold mutexes, which can't be moved, so they live behind pointers
+        std::vector<std::unique_ptr<Queue>> queues;
+        // Tasks pushed but not finished yet; the pool is done when this hits 0
+        std::atomic<long int> pending;
+        // Tasks sitting in the queues, only changed with the queue's lock held, so it's never more than what's there
+        std::atomic<long int> queued;
+        std::atomic<int> idle;
+        std::atomic<bool> failed;
+        // Idle threads wait here for queued, pending or failed to change
+        std::mutex park_mutex;
+        std::condition_variable parked;
+
+        bool pop(int thread, Task& out)
+        {
+            Queue& queue = *queues[thread];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) return false;
+            out = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+
+        bool steal(int thread, Task& out)
+        {
+            for (int i = 1; i < num_threads; i++)
+            {
+                Queue& queue = *queues[(thread + i) % num_threads];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty()) continue;
+                out = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                queued.fetch_sub(1);
+                return true;
+            }
+            return false;
+        }
+
+        // Taking the lock first means a thread that's just seen the old state is already waiting
+        void wake_all()
+        {
+            {std::lock_guard<std::mutex> lock(park_mutex);}
+            parked.notify_all();
+        }
+
+        // Drops whatever a failed run left behind, so the next one starts from nothing
+        void reset()
+        {
+            for (auto& queue : queues) queue->tasks.clear();
+            pending.store(0);
+            queued.store(0);
+            idle.store(0);
+            failed.store(false);
+        }
+
+        template<typename Process>
+        void work(int thread, Process& process, std::exception_ptr& error)
+        {
+            bool is_idle = false;
+            Task task;
+            while (!failed.load(std::memory_order_relaxed))
+            {
+                if (pop(thread, task) || steal(thread, task))
+                {
+                    if (is_idle) idle.fetch_sub(1);
+                    is_idle = false;
+                    try {process(task, thread);}
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                        failed.store(true);
+                        wake_all();
+                    }
+                    if (pending.fetch_sub(1) == 1) wake_all();
+                    continue;
+                }
+
+                // Going idle before looking at queued pairs up with push, which bumps queued before looking at idle,
+                // so one of them always sees the other
+                if (!is_idle) idle.fetch_add(1);
+                is_idle = true;
+                std::unique_lock<std::mutex> lock(park_mutex);
+                parked.wait(lock, [this] {return queued.load() > 0 || pending.load() == 0 || failed.load();});
+                if (pending.load() == 0) break;
+            }
+            if (is_idle) idle.fetch_sub(1);
+        }
+
+    public:
+        // num_threads <= 0 means one per core
+        WorkStealingPool(int num_threads=0) : pending(0), queued(0), idle(0), failed(false)
+        {
+            if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+            this->num_threads = num_threads > 0 ? num_threads : 1;
+            for (int i = 0; i < this->num_threads; i++) queues.emplace_back(new Queue);
+        }
+
+        int get_num_threads() const {return num_threads;}
+        // Whether any thread is waiting for work, so it's worth splitting up what you're doing
+        bool hungry() const {return idle.load(std::memory_order_relaxed) > 0;}
+
+        // Only call this from inside a task, with the thread number the task was given
+        void push(Task task, int thread)
+        {
+            pending.fetch_add(1);
+            {
+                Queue& queue = *queues[thread];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(std::move(task));
+                queued.fetch_add(1);
+            }
+            if (idle.load() > 0)
+            {
+                {std::lock_guard<std::mutex> lock(park_mutex);}
+                parked.notify_one();
+            }
+        }
+
+        // Calls process(Task&, int thread) on the initial tasks and everything they push, and returns when all are done
+        // The calling thread works as thread 0. If a task throws, the rest are abandoned and the exception is rethrown here
+        template<typename Process>
+        void run(std::vector<Task> initial, Process process)
+        {
+            reset();
+            for (std::size_t i = 0; i < initial.size(); i++) push(std::move(initial[i]), i % num_threads);
+
+            std::vector<std::exception_ptr> errors(num_threads);
+            std::vector<std::thread> threads;
+            for (int thread = 1; thread < num_threads; thread++)
+                threads.emplace_back([this, thread, &process, &errors] {work(thread, process, errors[thread]);});
+            work(0, process, errors[0]);
+            for (auto& thread : threads) thread.join();
+
+            reset();
+            for (auto& error : errors) if (error) std::rethrow_exception(error);
+        }
+};
+
+
+// An unsigned integer of any size, with just what counting classes needs
+// Limbs are 32 bits, least significant first, with no leading zero limbs (so zero has none)
+class BigUnsigned
+{
+    public:
+        BigUnsigned(std::uint64_t value=0);
+
+        bool is_zero() const {return limbs.empty();}
+        bool fits_u64() const {return limbs.size() <= 2;}
+        std::uint64_t to_u64() const;
+        std::string to_string() const;
+
+        BigUnsigned& operator+=(BigUnsigned const& other);
+        BigUnsigned& operator*=(std::uint32_t factor);
+        // Divides in place and returns the remainder
+        std::uint32_t divide(std::uint32_t divisor);
+
+        friend BigUnsigned operator+(BigUnsigned a, BigUnsigned const& b) {return a += b;}
+        friend bool operator==(BigUnsigned const& a, BigUnsigned const& b) {return a.limbs == b.limbs;}
+        friend bool operator!=(BigUnsigned const& a, BigUnsigned const& b) {return a.limbs != b.limbs;}
+        friend bool operator<(BigUnsigned const& a, BigUnsigned const& b);
+        friend std::ostream& operator<<(std::ostream& out, BigUnsigned const& num) {return out << num.to_string();}
+
+    private:
+        std::vector<std::uint32_t> limbs;
+
+        void trim() {while (!limbs.empty() && !limbs.back()) limbs.pop_back();}
+};
+
+
+// Counts the chord sets on an n-cycle up to rotation and reflection, i.e. the graphs ChordEnumerator lists,
+// without listing them
+// By Burnside's lemma the number of orbits of k-chord sets is the average over the group of how many k-chord sets
+// each element fixes. An element fixes a set exactly when the set is a union of the element's cycles on chords,
+// so the count for every k at once is the coefficient of x^k in the average of prod over cycles of (1 + x^length)
+// Elements with the same cycle type give the same product, so each type is only multiplied out once: the length
+// with the most cycles goes in as binomial coefficients, and the others one (1 + x^length) at a time, which is
+// just an addition per coefficient. n = 100 takes a fraction of a second
+class OrbitCounter
+{
+    public:
+        explicit OrbitCounter(int nvert);
+
+        int get_num_vertices() const {return num_vertices;}
+        // Classes with exactly this many chords (0 if it's out of range)
+        BigUnsigned count(int chords) const;
+        // Classes with min_chords .. max_chords chords, where max_chords < 0 means no limit (like ChordEnumerator)
+        BigUnsigned count(int min_chords, int max_chords) const;
+        // All the classes
+        BigUnsigned total() const {return count(0, -1);}
+        // Indexed by number of chords
+        std::vector<BigUnsigned> const& get_counts() const {return counts;}
+
+    private:
+        int num_vertices;
+        std::vector<BigUnsigned> counts;
+};
+
+
+// What ChordEnumerator::parallel_classify found
+struct EnumerationResult
+{
+    unsigned long long int num_graphs = 0;
+    unsigned long long int num_matches = 0;
+    // Graph numbers of the graphs the predicate accepted, if they were kept (in no particular order)
+    std::vector<GraphNumber> matches;
+};
+
+
+// Lists every chord set on an n-cycle exactly once, up to rotation and reflection
+// This is orderly generation: the parent of a canonical graph is the same graph without its lowest chord,
+// which is always canonical too (see Canonicalizer), so children are made by adding a chord below the
+// lowest one and kept only if they're canonical. No table of graphs seen so far is needed.
+// Every graph handed out is canonical, i.e. get_graph_num() == get_graph_iso_num()
+class ChordEnumerator
+{
+    private:
+        int num_vertices;
+        int min_chords;
+        int max_chords;
+        Canonicalizer const* canon;
+        // Every possible chord, in graph number order
+        std::vector<Chord> all_chords;
+
+        // split(graph, lowest) gets a chance to take each child elsewhere (e.g. to another thread)
+        // If it returns true, the child's subtree isn't walked here
+        template<typename Visitor, typename Split>
+        void visit_subtree(Hamiltonian& graph, unsigned long int lowest, Visitor& visit, Split& split) const
+        {
+            if (graph.get_num_chords() >= min_chords) visit(static_cast<Hamiltonian const&>(graph));
+            if (graph.get_num_chords() >= max_chords) return;
+
+            // Chords can only be added below idx from here on, so skip children that can't reach min_chords
+            long int first = static_cast<long int>(min_chords) - graph.get_num_chords() - 1;
+            for (unsigned long int idx = first > 0 ? first : 0; idx < lowest; idx++)
+            {
+                graph.add_chord(all_chords[idx]);
+                if (canon->is_canonical(graph) && !split(static_cast<Hamiltonian const&>(graph), idx))
+                    visit_subtree(graph, idx, visit, split);
+                graph.remove_chord(all_chords[idx]);
+            }
+        }
+
+    public:
+        // max_chords < 0 means no limit
+        ChordEnumerator(int nvert, int min_chords=0, int max_chords=-1);
+
+        int get_num_vertices() const {return num_vertices;}
+        int get_min_chords() const {return min_chords;}
+        int get_max_chords() const {return max_chords;}
+
+        // Calls visit(Hamiltonian const&) on every graph, depth first
+        // The graph is reused between calls, so copy it if you need to keep it
+        template<typename Visitor>
+        void for_each(Visitor visit) const
+        {
+            Hamiltonian graph(num_vertices);
+            auto never = [](Hamiltonian const&, unsigned long int) {return false;};
+            visit_subtree(graph, all_chords.size(), visit, never);
+        }
+
+        // Runs pred(Hamiltonian const&) -> bool on every graph, spread over num_threads threads (0 means one per core)
+        // pred gets called from several threads at once, so it can't have unsynchronized side effects
+        // Subtrees whose root has fewer than prefix_chords chords are always handed to the pool, and after that
+        // busy threads give away children whenever some thread is out of work
+        template<typename Predicate>
+        EnumerationResult parallel_classify(Predicate pred, int num_threads=0, bool keep_matches=false, int prefix_chords=2) const;
+
+        // Splits for_each into num_shards disjoint parts that can run anywhere without talking to each other
+        // The tree is cut at prefix_chords chords (at least 1): the subtrees rooted there are dealt out round
+        // robin in the order for_each reaches them, and the few graphs above the cut all go to shard 0. Every
+        // shard walks the top of the tree itself, which is cheap for small prefix_chords
+        // A unit is one of this shard's subtrees or top graphs. progress(units_done) is called after each one
+        // and can return false to stop early, and the first skip units are passed over without visiting
+        // anything, so a run that recorded its units_done can be picked up from there
+        template<typename Visitor, typename Progress>
+        void for_each_in_shard(int shard, int num_shards, int prefix_chords, Visitor visit, Progress progress,
+            unsigned long long int skip=0) const;
+
+        // Same graphs in the same order as for_each, but lazily
+        class iterator
+        {
+            public:
+                using iterator_category = std::input_iterator_tag;
+                using difference_type = std::ptrdiff_t;
+                using value_type = Hamiltonian;
+                using pointer = Hamiltonian const*;
+                using reference = Hamiltonian const&;
+
+            private:
+                ChordEnumerator const* gen;
+                Hamiltonian graph;
+                // Chords in the current graph, in the order they were added (so decreasing)
+                std::vector<unsigned long int> added;
+                bool done;
+
+                unsigned long int lowest() const {return added.empty() ? gen->all_chords.size() : added.back();}
+                // Adds the first canonical child with a chord in [from, lowest()), if there is one
+                bool push_child(unsigned long int from);
+                void step();
+
+            public:
+                iterator() : gen(nullptr), done(true) {}
+                iterator(ChordEnumerator const* theGen);
+
+                reference operator*() const {return graph;}
+                pointer operator->() const {return &graph;}
+                iterator& operator++();
+                iterator operator++(int);
+
+                friend bool operator==(iterator const& a, iterator const& b) {return a.done == b.done && (a.done || a.added == b.added);}
+                friend bool operator!=(iterator const& a, iterator const& b) {return !(a==b);}
+        };
+
+        iterator begin() const {return iterator(this);}
+        iterator end() const {return iterator();}
+};
+
+template<typename Visitor, typename Progress>
+void ChordEnumerator::for_each_in_shard(int shard, int num_shards, int prefix_chords, Visitor visit, Progress progress,
+    unsigned long long int skip) const
+{
+    if (num_shards < 1 || shard < 0 || shard >= num_shards) throw std::invalid_argument("Shard has to be in 0 .. num_shards-1");
+    if (prefix_chords < 1) throw std::invalid_argument("Shards need a prefix of at least 1 chord");
+
+    // Subtrees seen by every shard, and units of this shard's done (skipped ones included)
+    unsigned long long int subtrees = 0;
+    unsigned long long int units = 0;
+    bool stopped = false;
+    auto top_visit = [&](Hamiltonian const& graph)
+    {
+        if (stopped || shard != 0) return;
+        if (units++ < skip) return;
+        visit(graph);
+        if (!progress(units)) stopped = true;
+    };
+    auto never = [](Hamiltonian const&, unsigned long int) {return false;};
+    auto split = [&](Hamiltonian const& graph, unsigned long int lowest)
+    {
+        // Stopping prunes the rest of the walk
+        if (graph.get_num_chords() < prefix_chords) return stopped;
+        if (subtrees++ % num_shards != static_cast<unsigned long long int>(shard) || stopped) return true;
+        if (units++ < skip) return true;
+        Hamiltonian root = graph;
+        visit_subtree(root, lowest, visit, never);
+        if (!progress(units)) stopped = true;
+        return true;
+    };
+    Hamiltonian graph(num_vertices);
+    visit_subtree(graph, all_chords.size(), top_visit, split);
+}
+
+template<typename Predicate>
+EnumerationResult ChordEnumerator::parallel_classify(Predicate pred, int num_threads, bool keep_matches, int prefix_chords) const
+{
+    // A subtree to walk: its root graph, and the lowest chord in it
+    struct Node
+    {
+        Hamiltonian graph;
+        unsigned long int lowest;
+    };
+    // Each thread only touches its own result, and they're padded apart so they don't share cache lines
+    struct alignas(64) ThreadResult
+    {
+        EnumerationResult result;
+    };
+
+    WorkStealingPool<Node> pool(num_threads);
+    std::vector<ThreadResult> results(pool.get_num_threads());
+
+    auto process = [&](Node& node, int thread)
+    {
+        EnumerationResult& result = results[thread].result;
+        auto visit = [&](Hamiltonian const& graph)
+        {
+            result.num_graphs++;
+            if (!pred(graph)) return;
+            result.num_matches++;
+            if (keep_matches) result.matches.push_back(graph.get_graph_num());
+        };
+        // Don't bother giving away subtrees that are about to bottom out anyway
+        auto split = [&](Hamiltonian const& graph, unsigned long int lowest)
+        {
+            if (graph.get_num_chords() >= max_chords || lowest == 0) return false;
+            if (graph.get_num_chords() > prefix_chords && !pool.hungry()) return false;
+            pool.push(Node{graph, lowest}, thread);
+            return true;
+        };
+        visit_subtree(node.graph, node.lowest, visit, split);
+    };
+    pool.run({Node{Hamiltonian(num_vertices), all_chords.size()}}, process);
+
+    // Merge the per-thread buffers
+    EnumerationResult merged;
+    for (auto& thread_result : results)
+    {
+        merged.num_graphs += thread_result.result.num_graphs;
+        merged.num_matches += thread_result.result.num_matches;
+        merged.matches.insert(merged.matches.end(),
+            std::make_move_iterator(thread_result.result.matches.begin()),
+            std::make_move_iterator(thread_result.result.matches.end()));
+    }
+    return merged;
+}
+
+// Finds the fewest chords that make the n-cycle pancyclic, and every chord set that does it with that many, up to
+// rotation and reflection (n from 3 to 64)
+// It's iterative deepening on the number of chords k, starting from what the cycle space allows: c chords make
+// it c + 1 dimensional, so there are at most 2^(c+1) - 1 cycles to cover the n - 2 lengths with. Each k is an
+// orderly search like ChordEnumerator's, branching on chords in graph number order and keeping only canonical
+// children, with the cycle lengths tracked incrementally as chords go on and come off (see track_cycle_lengths)
+// Children are tried in order of how many of the missing lengths they add, and dropped when the chords left can't
+// make enough new cycles for the lengths still missing, which is the same cycle space count. Subtrees are handed
+// out to threads through a WorkStealingPool. Before any of that, adding whichever chord adds the most missing
+// lengths until it's pancyclic gives a first solution, so there's always a best one so far
+class PancyclicSearch
+{
+    public:
+        struct Progress
+        {
+            // The number of chords being searched now. Everything with fewer has been ruled out
+            int chords = 0;
+            // Chords in the best solution so far, which is best, or -1 if there isn't one yet
+            int best_chords = -1;
+            GraphNumber best;
+            unsigned long long int nodes = 0;
+            // Solutions with chords chords found so far
+            unsigned long long int solutions = 0;
+            double seconds = 0;
+            bool done = false;
+        };
+
+        struct Result
+        {
+            int min_chords = -1;
+            // Every optimal chord set, as canonical graph numbers in increasing order
+            std::vector<GraphNumber> solutions;
+            unsigned long long int nodes = 0;
+        };
+
+        // num_threads <= 0 means one per core
+        explicit PancyclicSearch(int nvert, int num_threads=0);
+
+        // report is called at the start of each chord count, about every every_seconds in between (from whichever
+        // search thread notices, one at a time), and once at the end with done set
+        void set_progress(std::function<void(Progress const&)> report, double every_seconds=10);
+
+        // Fewest chords the cycle space count allows
+        static int lower_bound(int nvert);
+        // The greedy solution: canonical, but not necessarily optimal
+        Hamiltonian greedy() const;
+        Result run();
+
+    private:
+        int num_vertices;
+        int num_threads;
+        std::function<void(Progress const&)> report;
+        double report_seconds = 10;
+};
+
+// A set of graph numbers for one n that any number of threads can insert into at once, e.g. to dedup
+// canonical forms found by parallel workers
+// Keys are split into shards by the top bits of their hash, and each shard is an open addressing table with
+// the keys' words stored inline in one flat array. Each slot has a tag word that says whether it's empty,
+// being written or full, along with most of the key's hash. A new key claims its slot with one CAS on the tag,
+// so inserts into the same shard don't block each other, and other keys are only compared when the hash matches
+// Shards only lock to grow: inserts share the lock, and whoever pushes a shard over the load limit takes it alone
+class GraphNumberSet
+{
+    public:
+        using word_type = GraphNumber::word_type;
+
+        struct Stats
+        {
+            std::size_t size;
+            std::size_t capacity;
+            double load_factor;
+            // Fullest and emptiest shards, as load factors
+            double max_shard_load;
+            double min_shard_load;
+            // How far keys are from their home slot, on average and at worst
+            double mean_probe_length;
+            std::size_t max_probe_length;
+        };
+
+        // num_shards is rounded up to a power of 2. 0 means a few per core
+        explicit GraphNumberSet(int nvert, int num_shards=0, std::size_t initial_capacity=0);
+        GraphNumberSet(GraphNumberSet const&) = delete;
+        GraphNumberSet& operator=(GraphNumberSet const&) = delete;
+
+        int get_num_vertices() const {return num_vertices;}
+        unsigned int get_num_words() const {return num_words;}
+
+        // Returns true if num wasn't there already. num has to have exactly get_num_words() words
+        bool insert(GraphNumber const& num);
+        bool insert(word_type const* words);
+        // Inserts graph's canonical form
+        bool insert_canonical(Hamiltonian const& graph);
+        bool contains(GraphNumber const& num) const;
+
+        std::size_t size() const;
+        Stats stats() const;
+        // Calls visit(word_type const* words) on every key, in no particular order
+        // Keys inserted while this runs may or may not be visited
+        template<typename Visitor>
+        void for_each(Visitor visit) const;
+
+    private:
+        // Tags are the key's hash with the bottom 2 bits replaced by the slot's state. 0 is an empty slot
+        static constexpr std::uint64_t CLAIMED = 1;
+        static constexpr std::uint64_t FULL = 2;
+        static constexpr std::uint64_t state_mask = 3;
+        // Shards grow when they'd be more than this full
+        static constexpr double max_load = 0.7;
+
+        struct alignas(64) Shard
+        {
+            mutable std::shared_mutex mutex;
+            std::unique_ptr<std::atomic<std::uint64_t>[]> tags;
+            std::unique_ptr<word_type[]> keys;
+            std::size_t capacity = 0;
+            std::atomic<std::size_t> count{0};
+        };
+
+        int num_vertices;
+        unsigned int num_words;
+        unsigned int shard_bits;
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        Shard& shard_for(std::size_t hash) const {return *shards[shard_bits ? hash >> (64 - shard_bits) : 0];}
+        // Skips the bits tags use for the state, so a key's home slot can be found from its tag
+        static std::size_t home_slot(Shard const& shard, std::size_t hash) {return (hash >> 2) & (shard.capacity - 1);}
+        void allocate(Shard& shard, std::size_t capacity) const;
+        void grow(Shard& shard, std::size_t seen_capacity);
+};
+
+template<typename Visitor>
+void GraphNumberSet::for_each(Visitor visit) const
+{
+    for (auto const& shard : shards)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        for (std::size_t slot = 0; slot < shard->capacity; slot++)
+        {
+            if ((shard->tags[slot].load(std::memory_order_acquire) & state_mask) == FULL)
+                visit(static_cast<word_type const*>(&shard->keys[slot * num_words]));
+        }
+    }
+}
+
+
+// Runs ChordEnumerator::for_each_in_shard shards into catalogs, one process per shard, and merges them
+// Everything for shard i of N goes in dir, named after n, i and N:
+//   shard-n-i-of-N.records      graph numbers found so far, appended as they're found
+//   shard-n-i-of-N.checkpoint   one line of text: the settings, units done, and how long the records are
+//   shard-n-i-of-N.catalog      the shard's Catalog, once it's done
+// Checkpoints are written to a temporary file and renamed over the old one. A resumed run cuts the records back
+// to the last checkpoint and skips the units it covers, so work after the last checkpoint is just done again
+class ShardedEnumeration
+{
+    public:
+        struct Settings
+        {
+            int num_vertices = 0;
+            int num_shards = 1;
+            int prefix_chords = 3;
+            int min_chords = 0;
+            int max_chords = -1;
+
+            bool operator==(Settings const& other) const;
+            bool operator!=(Settings const& other) const {return !(*this == other);}
+        };
+
+        struct MergeReport
+        {
+            std::uint64_t num_graphs = 0;
+            // Graphs each shard had, to see how even the split was
+            std::vector<std::uint64_t> shard_graphs;
+        };
+
+        ShardedEnumeration(std::string const& dir, Settings const& settings);
+
+        Settings const& get_settings() const {return settings;}
+        std::string path(int shard, char const* kind) const;
+
+        // Runs or resumes a shard, checkpointing at most every checkpoint_seconds, until it's done (returns true)
+        // or time_limit_seconds is up (returns false, if it's positive). Running a finished shard does nothing
+        bool run(int shard, double checkpoint_seconds=60, double time_limit_seconds=0) const;
+        bool finished(int shard) const;
+
+        // Merges every shard's catalog into one at out_path, after checking every shard finished with the same
+        // settings, no graph is in two shards, and the count for every chord count matches OrbitCounter
+        // Throws std::runtime_error saying what's wrong otherwise, and writes nothing
+        MergeReport merge(std::string const& out_path) const;
+
+    private:
+        std::string dir;
+        Settings settings;
+
+        struct Checkpoint
+        {
+            Settings settings;
+            unsigned long long int units = 0;
+            std::uint64_t records = 0;
+            bool done = false;
+        };
+        bool read_checkpoint(int shard, Checkpoint& out) const;
+        void write_checkpoint(int shard, Checkpoint const& checkpoint) const;
+};
+
+// A read-only catalog of canonical graph numbers for one n, memory mapped straight from disk
+// Layout, all in native byte order:
+//   Header
+//   offsets: max_num_chords + 2 uint64s. Graphs with c chords are records offsets[c] .. offsets[c+1]
+//   records: the graph number's words, then one property word if the catalog has properties
+// Records are sorted by chord count, then by graph number, so lookups are binary searches within a chord count
+// Records are handed out as pointers into the mapping, so nothing is copied
+class Catalog
+{
+    public:
+        using word_type = GraphNumber::word_type;
+
+        struct Header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t num_vertices;
+            std::uint32_t num_words;
+            std::uint32_t flags;
+            std::uint64_t num_graphs;
+            std::uint64_t max_chords;
+        };
+        static constexpr char magic[8] = {'P', 'A', 'N', 'C', 'C', 'A', 'T', '\0'};
+        static constexpr std::uint32_t version = 1;
+        static constexpr std::uint32_t HAS_PROPERTIES = 1;
+
+        // Property bits. The number of crossing components goes in the top half of the word
+        static constexpr std::uint64_t PANCYCLIC = 1;
+        static constexpr unsigned int component_shift = 32;
+        // The properties above, worked out for graph (pancyclicity needs at most 64 vertices)
+        static std::uint64_t properties_of(Hamiltonian const& graph);
+
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        explicit Catalog(std::string const& path);
+        ~Catalog();
+        Catalog(Catalog const&) = delete;
+        Catalog& operator=(Catalog const&) = delete;
+
+        int get_num_vertices() const {return header->num_vertices;}
+        unsigned int get_num_words() const {return header->num_words;}
+        bool has_properties() const {return header->flags & HAS_PROPERTIES;}
+        std::size_t size() const {return header->num_graphs;}
+
+        word_type const* words(std::size_t idx) const {return records + idx * stride;}
+        GraphNumber graph_num(std::size_t idx) const {return GraphNumber(words(idx), get_num_words());}
+        std::uint64_t properties(std::size_t idx) const {return has_properties() ? words(idx)[get_num_words()] : 0;}
+
+        // Records [first, second) are the graphs with that many chords
+        std::pair<std::size_t, std::size_t> chord_count_range(int chords) const;
+        // First record with this chord count whose graph number isn't less than words
+        std::size_t lower_bound(int chords, word_type const* words) const;
+        // Index of the record, or npos. The graph number has to be canonical to be found
+        std::size_t find(GraphNumber const& num) const;
+        bool contains(GraphNumber const& num) const {return find(num) != npos;}
+
+    private:
+        Header const* header;
+        std::uint64_t const* offsets;
+        word_type const* records;
+        unsigned int stride;
+        void* mapping;
+        std::size_t mapping_size;
+
+        // Checks the header and offsets against each other and the mapping's size, and sets up offsets,
+        // records and stride if they're good
+        bool valid_mapping();
+};
+
+// Builds a Catalog file from graphs that come in in any order, from any number of threads
+// Each chord count is spooled to its own file next to the catalog, and finish() sorts them one at a time and
+// stitches them together, so only the biggest chord count has to fit in memory
+// Duplicates are dropped. If finish() is never called, the spools are deleted and no catalog is written
+class CatalogWriter
+{
+    public:
+        using word_type = GraphNumber::word_type;
+
+        CatalogWriter(std::string const& path, int nvert, bool with_properties=false);
+        ~CatalogWriter();
+        CatalogWriter(CatalogWriter const&) = delete;
+        CatalogWriter& operator=(CatalogWriter const&) = delete;
+
+        // graph should already be canonical, which everything from ChordEnumerator is
+        void append(Hamiltonian const& graph, std::uint64_t properties=0);
+        void append(GraphNumber const& num, std::uint64_t properties=0);
+
+        // Returns the number of graphs written
+        std::uint64_t finish();
+
+    private:
+        struct Spool
+        {
+            std::mutex mutex;
+            std::FILE* file = nullptr;
+            // Whether the spool's file is on disk, which can outlast file when finish() closes it and then fails
+            bool created = false;
+        };
+
+        std::string path;
+        int num_vertices;
+        unsigned int num_words;
+        bool with_properties;
+        // started is set once finish() has opened the catalog, so a finish() that fails can have its half written
+        // catalog deleted (its placeholder header would otherwise open as an empty catalog)
+        bool started;
+        bool finished;
+        std::vector<std::unique_ptr<Spool>> spools;
+
+        std::string spool_path(int chords) const {return path + ".spool" + std::to_string(chords);}
+        void remove_spools();
 };
 
 
@@ -199,10 +2017,3 @@ class Hamiltonian
 // TODO: Consider the independent component rotations as permutations.
 // The equivalence class is described as the orbit of the graph under the set of allowed permutations, which is closed.
 // However, this doesn't apply when we move one chord component to touch another chord component
-
-// TODO: Think of algo to make tree out of chord components
-// Pretty sure it involves considering each vertex and checking which spans it falls into in a specific hamiltonian
-// Idea: loop through each span in the hamiltonian, and check which chords create it, and which components they're in
-// Those components are coincident
-// Brainstorm:
-// - 
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "pancyclic.h"
+
+namespace
+{
+    using mask_type = std::uint64_t;
+    using Progress = PancyclicSearch::Progress;
+
+    // Whether remaining more chords on top of chords can make enough new cycles for missing lengths
+    // Every new cycle uses a new chord, and there are 2^(chords+1) * (2^remaining - 1) of those in the cycle space
+    bool enough_cycles(int chords, int remaining, int missing)
+    {
+        if (chords + remaining >= 62) return true;
+        return static_cast<std::uint64_t>(missing) <= (std::uint64_t(1) << (chords + 1)) * ((std::uint64_t(1) << remaining) - 1);
+    }
+
+    double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Searches every chord set with exactly num_chords chords
+    class LevelSearch
+    {
+        public:
+            struct Node
+            {
+                Hamiltonian graph;
+                unsigned long int lowest;
+            };
+
+        private:
+            int num_vertices;
+            int num_chords;
+            mask_type all;
+            Canonicalizer const& canon;
+            std::vector<Chord> all_chords;
+            WorkStealingPool<Node> pool;
+
+            // Each thread's scratch space for the children of the node it's on at each depth, and its node count
+            // Only the thread itself writes its count, so it's a plain store, but the reporter can read it any time
+            struct alignas(64) Worker
+            {
+                std::vector<std::vector<std::pair<int, unsigned long int>>> children;
+                std::atomic<unsigned long long int> nodes{0};
+            };
+            std::vector<Worker> workers;
+
+            std::mutex solutions_mutex;
+            std::vector<GraphNumber> solutions;
+
+            std::function<void(Progress const&)> const& report;
+            Progress base;
+            std::chrono::steady_clock::time_point start;
+            double report_seconds;
+            std::atomic<double> next_report;
+            std::mutex report_mutex;
+
+            void record(Hamiltonian const& graph)
+            {
+                std::lock_guard<std::mutex> lock(solutions_mutex);
+                solutions.push_back(graph.get_graph_num());
+            }
+
+            void maybe_report()
+            {
+                if (!report || seconds_since(start) < next_report.load(std::memory_order_relaxed)) return;
+                std::unique_lock<std::mutex> lock(report_mutex, std::try_to_lock);
+                if (!lock) return;
+                report(progress());
+                next_report.store(seconds_since(start) + report_seconds);
+            }
+
+            void expand(Hamiltonian& graph, unsigned long int lowest, int thread)
+            {
+                Worker& worker = workers[thread];
+                int const depth = graph.get_num_chords();
+                int const remaining = num_chords - depth;
+                auto& children = worker.children[depth];
+                children.clear();
+
+                // Every child that's canonical and can still make it, along with how many lengths it's missing
+                // The rest of the chords go below this one, so leave room for them
+                GraphNumber num = graph.get_graph_num();
+                unsigned long long int nodes = worker.nodes.load(std::memory_order_relaxed);
+                for (unsigned long int idx = remaining - 1; idx < lowest; idx++)
+                {
+                    if ((++nodes & 4095) == 0)
+                    {
+                        worker.nodes.store(nodes, std::memory_order_relaxed);
+                        maybe_report();
+                    }
+                    num.set(idx);
+                    bool const canonical = canon.is_canonical(num);
+                    num.reset(idx);
+                    if (!canonical) continue;
+
+                    graph.add_chord(all_chords[idx]);
+                    mask_type const missing = all & ~graph.get_cycle_lengths();
+                    if (remaining == 1)
+                    {
+                        if (!missing) record(graph);
+                    }
+                    else if (enough_cycles(depth + 1, remaining - 1, __builtin_popcountll(missing)))
+                        children.emplace_back(__builtin_popcountll(missing), idx);
+                    graph.remove_chord(all_chords[idx]);
+                }
+                worker.nodes.store(nodes, std::memory_order_relaxed);
+
+                // The chords that leave the fewest lengths missing go first
+                std::sort(children.begin(), children.end());
+                for (std::size_t child = 0; child < children.size(); child++)
+                {
+                    unsigned long int const idx = children[child].second;
+                    graph.add_chord(all_chords[idx]);
+                    // Don't bother giving away a subtree that's just one more chord
+                    if (remaining > 2 && pool.hungry()) pool.push(Node{graph, idx}, thread);
+                    else expand(graph, idx, thread);
+                    graph.remove_chord(all_chords[idx]);
+                }
+            }
+
+        public:
+            LevelSearch(int nvert, int chords, int num_threads, std::function<void(Progress const&)> const& report,
+                Progress const& base, std::chrono::steady_clock::time_point start, double report_seconds) :
+                num_vertices(nvert), num_chords(chords), all(Hamiltonian::all_cycle_lengths(nvert)), canon(Canonicalizer::for_vertices(nvert)),
+                pool(num_threads), workers(pool.get_num_threads()), report(report), base(base), start(start),
+                report_seconds(report_seconds), next_report(seconds_since(start) + report_seconds)
+            {
+                for (unsigned long int idx = 0; idx < Chord::max_num_chords(nvert); idx++) all_chords.push_back(Chord::from_index(idx, nvert));
+                for (Worker& worker : workers) worker.children.resize(chords + 1);
+            }
+
+            void run()
+            {
+                Hamiltonian root(num_vertices);
+                root.track_cycle_lengths();
+                mask_type const missing = all & ~root.get_cycle_lengths();
+                if (num_chords == 0)
+                {
+                    if (!missing) record(root);
+                    return;
+                }
+                if (!enough_cycles(0, num_chords, __builtin_popcountll(missing))) return;
+                pool.run({Node{root, all_chords.size()}}, [this](Node& node, int thread) {expand(node.graph, node.lowest, thread);});
+            }
+
+            unsigned long long int get_nodes() const
+            {
+                unsigned long long int total = 0;
+                for (Worker const& worker : workers) total += worker.nodes.load(std::memory_order_relaxed);
+                return total;
+            }
+
+            std::vector<GraphNumber>& get_solutions() {return solutions;}
+
+            Progress progress()
+            {
+                Progress ret = base;
+                ret.nodes += get_nodes();
+                ret.seconds = seconds_since(start);
+                std::lock_guard<std::mutex> lock(solutions_mutex);
+                ret.solutions = solutions.size();
+                if (!solutions.empty())
+                {
+                    ret.best_chords = num_chords;
+                    ret.best = solutions.front();
+                }
+                return ret;
+            }
+    };
+}
+
+
+PancyclicSearch::PancyclicSearch(int nvert, int num_threads) : num_vertices(nvert), num_threads(num_threads)
+{
+    if (nvert < 3 || nvert > 64) throw std::invalid_argument("PancyclicSearch only supports 3 to 64 vertices");
+}
+
+void PancyclicSearch::set_progress(std::function<void(Progress const&)> report, double every_seconds)
+{
+    this->report = std::move(report);
+    report_seconds = every_seconds;
+}
+
+int PancyclicSearch::lower_bound(int nvert)
+{
+    // Need 2^(c+1) - 1 >= n - 2
+    int chords = 0;
+    while ((std::uint64_t(1) << (chords + 1)) - 1 < static_cast<std::uint64_t>(nvert - 2)) chords++;
+    return chords;
+}
+
+Hamiltonian PancyclicSearch::greedy() const
+{
+    Hamiltonian graph(num_vertices);
+    graph.track_cycle_lengths();
+    mask_type const all = Hamiltonian::all_cycle_lengths(num_vertices);
+    while (graph.get_cycle_lengths() != all)
+    {
+        // Ties go to the first chord, so the answer doesn't depend on anything but n
+        unsigned long int best_idx = 0;
+        int best_missing = num_vertices + 1;
+        for (unsigned long int idx = 0; idx < Chord::max_num_chords(num_vertices); idx++)
+        {
+            Chord const chord = Chord::from_index(idx, num_vertices);
+            if (graph.has_chord(chord)) continue;
+            graph.add_chord(chord);
+            int const missing = __builtin_popcountll(all & ~graph.get_cycle_lengths());
+            graph.remove_chord(chord);
+            if (missing < best_missing)
+            {
+                best_missing = missing;
+                best_idx = idx;
+            }
+        }
+        graph.add_chord(Chord::from_index(best_idx, num_vertices));
+    }
+    graph.track_cycle_lengths(false);
+    graph.canonicalize();
+    return graph;
+}
+
+PancyclicSearch::Result PancyclicSearch::run()
+{
+    auto const start = std::chrono::steady_clock::now();
+    Hamiltonian const first = greedy();
+    Progress progress;
+    progress.best_chords = first.get_num_chords();
+    progress.best = first.get_graph_num();
+
+    Result result;
+    // The greedy solution means this stops by its chord count at the latest
+    for (int chords = lower_bound(num_vertices); result.min_chords < 0; chords++)
+    {
+        progress.chords = chords;
+        progress.solutions = 0;
+        progress.seconds = seconds_since(start);
+        if (report) report(progress);
+
+        LevelSearch level(num_vertices, chords, num_threads, report, progress, start, report_seconds);
+        level.run();
+        progress = level.progress();
+        result.nodes = progress.nodes;
+        if (level.get_solutions().empty()) continue;
+
+        result.min_chords = chords;
+        result.solutions = std::move(level.get_solutions());
+        std::sort(result.solutions.begin(), result.solutions.end());
+        progress.best = result.solutions.front();
+    }
+
+    progress.seconds = seconds_since(start);
+    progress.done = true;
+    if (report) report(progress);
+    return result;
+}
@@ -0,0 +1,66 @@
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include "pancyclic.h"
+
+using namespace std;
+
+// Finds the fewest chords that make the n-cycle pancyclic, and prints every optimal chord set up to symmetry
+//   pancyclic_search <n> [--threads T] [--report-seconds S] [--graph6]
+// Progress goes to stderr, and the solutions to stdout as graph number digits (or graph6)
+
+namespace
+{
+    int usage(char const* program)
+    {
+        cerr << "Usage: " << program << " <n> [--threads T] [--report-seconds S] [--graph6]" << endl;
+        return 1;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) return usage(argv[0]);
+    int const verts = atoi(argv[1]);
+    int threads = 0;
+    double report_seconds = 10;
+    bool graph6 = false;
+    for (int arg = 2; arg < argc; arg++)
+    {
+        if (!strcmp(argv[arg], "--graph6")) graph6 = true;
+        else if (arg + 1 == argc) return usage(argv[0]);
+        else if (!strcmp(argv[arg], "--threads")) threads = atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "--report-seconds")) report_seconds = atof(argv[++arg]);
+        else return usage(argv[0]);
+    }
+
+    try
+    {
+        PancyclicSearch search(verts, threads);
+        search.set_progress([verts](PancyclicSearch::Progress const& progress)
+        {
+            cerr << "[" << progress.seconds << "s] " << (progress.done ? "done at " : "trying ") << progress.chords << " chords, "
+                << progress.nodes << " nodes, " << progress.solutions << " solutions";
+            if (progress.best_chords >= 0)
+                cerr << ", best " << progress.best_chords << ": " << Hamiltonian(verts, progress.best).to_graph6();
+            cerr << endl;
+        }, report_seconds);
+
+        PancyclicSearch::Result const result = search.run();
+        cerr << "n = " << verts << ": " << result.min_chords << " chords, " << result.solutions.size() << " optimal chord sets" << endl;
+        for (GraphNumber const& solution : result.solutions)
+        {
+            if (graph6) cout << Hamiltonian(verts, solution).to_graph6() << '\n';
+            else cout << Hamiltonian::get_graph_num_digs(verts, solution) << '\n';
+        }
+    }
+    catch (exception const& error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
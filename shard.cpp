@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "pancyclic.h"
+
+namespace
+{
+    struct FileCloser
+    {
+        void operator()(std::FILE* file) const {if (file) std::fclose(file);}
+    };
+    using File = std::unique_ptr<std::FILE, FileCloser>;
+
+    char const checkpoint_magic[] = "pancyclic-shard";
+    int const checkpoint_version = 1;
+
+    double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+
+bool ShardedEnumeration::Settings::operator==(Settings const& other) const
+{
+    return num_vertices == other.num_vertices && num_shards == other.num_shards && prefix_chords == other.prefix_chords &&
+        min_chords == other.min_chords && max_chords == other.max_chords;
+}
+
+ShardedEnumeration::ShardedEnumeration(std::string const& dir, Settings const& settings) : dir(dir), settings(settings)
+{
+    // Shards end up in catalogs, which need chords to work with
+    if (settings.num_vertices < 4) throw std::invalid_argument("Sharded enumeration needs at least 4 vertices");
+    if (settings.num_shards < 1) throw std::invalid_argument("Need at least 1 shard");
+    if (settings.prefix_chords < 1) throw std::invalid_argument("Shards need a prefix of at least 1 chord");
+    // So settings from different runs compare equal whenever they mean the same thing
+    if (this->settings.max_chords < 0) this->settings.max_chords = -1;
+    if (this->settings.min_chords < 0) this->settings.min_chords = 0;
+    if (!dir.empty()) std::filesystem::create_directories(dir);
+}
+
+std::string ShardedEnumeration::path(int shard, char const* kind) const
+{
+    std::string name = "shard-" + std::to_string(settings.num_vertices) + "-" + std::to_string(shard) + "-of-" +
+        std::to_string(settings.num_shards) + "." + kind;
+    return dir.empty() ? name : (std::filesystem::path(dir) / name).string();
+}
+
+bool ShardedEnumeration::read_checkpoint(int shard, Checkpoint& out) const
+{
+    std::ifstream in(path(shard, "checkpoint"));
+    if (!in) return false;
+    std::string magic;
+    int version = 0;
+    in >> magic >> version;
+    Settings& saved = out.settings;
+    in >> saved.num_vertices >> saved.num_shards >> saved.prefix_chords >> saved.min_chords >> saved.max_chords
+        >> out.units >> out.records >> out.done;
+    if (!in || magic != checkpoint_magic || version != checkpoint_version)
+        throw std::runtime_error(path(shard, "checkpoint") + " isn't a shard checkpoint");
+    return true;
+}
+
+void ShardedEnumeration::write_checkpoint(int shard, Checkpoint const& checkpoint) const
+{
+    // Write it all somewhere else first, so a run killed halfway through leaves the old checkpoint alone
+    std::string const final_path = path(shard, "checkpoint");
+    std::string const temp_path = final_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        Settings const& saved = checkpoint.settings;
+        out << checkpoint_magic << ' ' << checkpoint_version << ' ' << saved.num_vertices << ' ' << saved.num_shards << ' '
+            << saved.prefix_chords << ' ' << saved.min_chords << ' ' << saved.max_chords << ' '
+            << checkpoint.units << ' ' << checkpoint.records << ' ' << checkpoint.done << '\n';
+        out.flush();
+        if (!out) throw std::runtime_error("Couldn't write checkpoint " + temp_path);
+    }
+    std::filesystem::rename(temp_path, final_path);
+}
+
+bool ShardedEnumeration::finished(int shard) const
+{
+    Checkpoint checkpoint;
+    return read_checkpoint(shard, checkpoint) && checkpoint.done;
+}
+
+bool ShardedEnumeration::run(int shard, double checkpoint_seconds, double time_limit_seconds) const
+{
+    if (shard < 0 || shard >= settings.num_shards) throw std::invalid_argument("Shard has to be in 0 .. num_shards-1");
+
+    Checkpoint checkpoint;
+    if (read_checkpoint(shard, checkpoint))
+    {
+        if (checkpoint.settings != settings)
+            throw std::runtime_error(path(shard, "checkpoint") + " was made with different settings");
+        if (checkpoint.done) return true;
+    }
+    else
+    {
+        checkpoint = Checkpoint();
+        checkpoint.settings = settings;
+    }
+
+    // Anything past the checkpoint is from units that will be done again
+    std::string const records_path = path(shard, "records");
+    if (checkpoint.units)
+    {
+        if (!std::filesystem::exists(records_path) || std::filesystem::file_size(records_path) < checkpoint.records)
+            throw std::runtime_error(records_path + " is shorter than its checkpoint says");
+        std::filesystem::resize_file(records_path, checkpoint.records);
+    }
+    File records(std::fopen(records_path.c_str(), checkpoint.units ? "ab" : "wb"));
+    if (!records) throw std::runtime_error("Couldn't open " + records_path);
+
+    unsigned int const num_words = GraphNumber::for_vertices(settings.num_vertices).size();
+    std::size_t const record_bytes = num_words * sizeof(GraphNumber::word_type);
+    auto const start = std::chrono::steady_clock::now();
+    auto last_checkpoint = start;
+    bool stopped = false;
+
+    auto save = [&]()
+    {
+        if (std::fflush(records.get()) != 0) throw std::runtime_error("Couldn't write " + records_path);
+        write_checkpoint(shard, checkpoint);
+        last_checkpoint = std::chrono::steady_clock::now();
+    };
+    auto visit = [&](Hamiltonian const& graph)
+    {
+        if (std::fwrite(graph.get_graph_num().data(), 1, record_bytes, records.get()) != record_bytes)
+            throw std::runtime_error("Couldn't write " + records_path);
+        checkpoint.records += record_bytes;
+    };
+    auto progress = [&](unsigned long long int units)
+    {
+        checkpoint.units = units;
+        if (time_limit_seconds > 0 && seconds_since(start) >= time_limit_seconds) stopped = true;
+        if (stopped || seconds_since(last_checkpoint) >= checkpoint_seconds) save();
+        return !stopped;
+    };
+
+    ChordEnumerator const enumerator(settings.num_vertices, settings.min_chords, settings.max_chords);
+    enumerator.for_each_in_shard(shard, settings.num_shards, settings.prefix_chords, visit, progress, checkpoint.units);
+    if (stopped) return false;
+    save();
+    records.reset();
+
+    // Sort the records into the shard's catalog. The enumeration never finds a class twice, so the catalog
+    // should have every record, and anything less means a resume went wrong
+    std::uint64_t const num_records = checkpoint.records / record_bytes;
+    CatalogWriter writer(path(shard, "catalog"), settings.num_vertices);
+    {
+        File in(std::fopen(records_path.c_str(), "rb"));
+        if (!in) throw std::runtime_error("Couldn't open " + records_path);
+        GraphNumber num(num_words);
+        for (std::uint64_t record = 0; record < num_records; record++)
+        {
+            if (std::fread(num.data(), 1, record_bytes, in.get()) != record_bytes)
+                throw std::runtime_error("Couldn't read " + records_path);
+            writer.append(num);
+        }
+    }
+    if (writer.finish() != num_records)
+    {
+        std::filesystem::remove(path(shard, "catalog"));
+        throw std::runtime_error(records_path + " has the same graph more than once");
+    }
+
+    checkpoint.done = true;
+    write_checkpoint(shard, checkpoint);
+    std::filesystem::remove(records_path);
+    return true;
+}
+
+ShardedEnumeration::MergeReport ShardedEnumeration::merge(std::string const& out_path) const
+{
+    std::vector<std::unique_ptr<Catalog>> catalogs;
+    for (int shard = 0; shard < settings.num_shards; shard++)
+    {
+        Checkpoint checkpoint;
+        if (!read_checkpoint(shard, checkpoint) || !checkpoint.done)
+            throw std::runtime_error("Shard " + std::to_string(shard) + " isn't done");
+        if (checkpoint.settings != settings)
+            throw std::runtime_error("Shard " + std::to_string(shard) + " was made with different settings");
+        catalogs.emplace_back(new Catalog(path(shard, "catalog")));
+        if (catalogs.back()->get_num_vertices() != settings.num_vertices)
+            throw std::runtime_error(path(shard, "catalog") + " has the wrong number of vertices");
+    }
+
+    int const most_chords = Chord::max_num_chords(settings.num_vertices);
+    int const max_chords = settings.max_chords < 0 ? most_chords : std::min(settings.max_chords, most_chords);
+    unsigned int const num_words = GraphNumber::for_vertices(settings.num_vertices).size();
+    OrbitCounter const counter(settings.num_vertices);
+
+    MergeReport report;
+    report.shard_graphs.assign(settings.num_shards, 0);
+    for (int shard = 0; shard < settings.num_shards; shard++) report.shard_graphs[shard] = catalogs[shard]->size();
+
+    CatalogWriter writer(out_path, settings.num_vertices);
+    std::vector<std::pair<std::size_t, std::size_t>> ranges(settings.num_shards);
+    for (int chords = 0; chords <= most_chords; chords++)
+    {
+        for (int shard = 0; shard < settings.num_shards; shard++) ranges[shard] = catalogs[shard]->chord_count_range(chords);
+
+        // Shard catalogs are each sorted, so merging them finds any class that's in two shards right next to itself
+        std::uint64_t found = 0;
+        for (;;)
+        {
+            int least = -1;
+            for (int shard = 0; shard < settings.num_shards; shard++)
+            {
+                if (ranges[shard].first == ranges[shard].second) continue;
+                if (least < 0)
+                {
+                    least = shard;
+                    continue;
+                }
+                int const order = GraphNumber::compare(catalogs[shard]->words(ranges[shard].first),
+                    catalogs[least]->words(ranges[least].first), num_words);
+                if (order == 0)
+                    throw std::runtime_error("Shards " + std::to_string(least) + " and " + std::to_string(shard) + " both have " +
+                        Hamiltonian::get_graph_num_digs(settings.num_vertices, catalogs[shard]->graph_num(ranges[shard].first)));
+                if (order < 0) least = shard;
+            }
+            if (least < 0) break;
+            writer.append(catalogs[least]->graph_num(ranges[least].first++));
+            found++;
+        }
+
+        BigUnsigned const expected = chords >= settings.min_chords && chords <= max_chords ? counter.count(chords) : BigUnsigned();
+        if (BigUnsigned(found) != expected)
+            throw std::runtime_error("Shards have " + std::to_string(found) + " graphs with " + std::to_string(chords) +
+                " chords, but there are " + expected.to_string());
+        report.num_graphs += found;
+    }
+    writer.finish();
+    return report;
+}
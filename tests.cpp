@@ -0,0 +1,601 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pancyclic.h"
+
+using namespace std;
+
+// Checks the library against something simpler: brute force, Burnside's lemma, or a round trip
+//   pancyclic_tests [check ...]
+// With no arguments every check runs. CMake registers each one as its own test
+
+// Only builds the message when the check fails, since some of these run millions of times
+#define EXPECT(ok, what) do {if (!(ok)) throw runtime_error(what);} while (false)
+
+namespace
+{
+    string describe(Hamiltonian const& graph)
+    {
+        return to_string(graph.get_num_vertices()) + " vertices, " + graph.to_graph6();
+    }
+
+    Hamiltonian random_graph(int nvert, double density, mt19937& rng)
+    {
+        bernoulli_distribution has_chord(density);
+        Hamiltonian graph(nvert);
+        for (unsigned long int idx = 0; idx < Chord::max_num_chords(nvert); idx++)
+            if (has_chord(rng)) graph.add_chord(Chord::from_index(idx, nvert));
+        return graph;
+    }
+
+    // Canonical forms the slow way: the biggest graph number over every rotation and reflection
+    GraphNumber naive_iso_num(Hamiltonian const& graph)
+    {
+        Hamiltonian copy = graph;
+        GraphNumber max = graph.get_graph_num();
+        for (int i = 0; i < 2 * graph.get_num_vertices() - 1; i++)
+        {
+            if (i == graph.get_num_vertices() - 1) copy.reflect();
+            else copy.rotate();
+            GraphNumber const num = copy.get_graph_num();
+            if (num > max) max = num;
+        }
+        return max;
+    }
+
+    // Cycle lengths by walking every simple path from each cycle's smallest vertex, with length L in bit L-1
+    // allowed is the vertices the path can still go to
+    void brute_dfs(vector<uint64_t> const& adj, int start, int cur, uint64_t allowed, int len, uint64_t& found)
+    {
+        if (len >= 3 && (adj[cur] >> start & 1)) found |= uint64_t(1) << (len - 1);
+        for (uint64_t next = adj[cur] & allowed; next; next &= next - 1)
+        {
+            int const vert = __builtin_ctzll(next);
+            brute_dfs(adj, start, vert, allowed & ~(uint64_t(1) << vert), len + 1, found);
+        }
+    }
+
+    uint64_t brute_cycle_lengths(Hamiltonian const& graph)
+    {
+        int const nvert = graph.get_num_vertices();
+        vector<uint64_t> adj(nvert);
+        for (int vert = 0; vert < nvert; vert++)
+            adj[vert] = (uint64_t(1) << (vert + 1) % nvert) | (uint64_t(1) << (vert + nvert - 1) % nvert);
+        for (Chord const& chord : graph.chord_vector())
+        {
+            adj[chord.get_start()] |= uint64_t(1) << chord.get_end();
+            adj[chord.get_end()] |= uint64_t(1) << chord.get_start();
+        }
+        uint64_t found = 0;
+        for (int start = 0; start < nvert; start++)
+        {
+            // Only vertices above start, so each cycle is only walked from its smallest vertex
+            uint64_t const above = (nvert == 64 ? ~uint64_t(0) : (uint64_t(1) << nvert) - 1) & ~((uint64_t(2) << start) - 1);
+            brute_dfs(adj, start, start, above, 1, found);
+        }
+        return found;
+    }
+
+    // Crossing components the slow way: flood fill over Chord::crossing
+    int brute_num_components(Hamiltonian const& graph)
+    {
+        vector<Chord> const chords = graph.chord_vector();
+        vector<int> label(chords.size(), -1);
+        int num = 0;
+        for (size_t first = 0; first < chords.size(); first++)
+        {
+            if (label[first] >= 0) continue;
+            vector<size_t> stack = {first};
+            label[first] = num;
+            while (!stack.empty())
+            {
+                size_t const cur = stack.back();
+                stack.pop_back();
+                for (size_t other = 0; other < chords.size(); other++)
+                {
+                    if (label[other] >= 0 || !chords[cur].crossing(chords[other])) continue;
+                    label[other] = num;
+                    stack.push_back(other);
+                }
+            }
+            num++;
+        }
+        return num;
+    }
+
+
+    void check_canonical(mt19937& rng)
+    {
+        for (int nvert = 4; nvert <= 30; nvert++)
+        {
+            Canonicalizer const& canon = Canonicalizer::for_vertices(nvert);
+            for (double density : {0.05, 0.2, 0.5, 0.9})
+            {
+                for (int trial = 0; trial < 20; trial++)
+                {
+                    Hamiltonian graph = random_graph(nvert, density, rng);
+                    GraphNumber const expected = naive_iso_num(graph);
+                    EXPECT(graph.get_graph_iso_num() == expected, "get_graph_iso_num is wrong for " + describe(graph));
+                    EXPECT(visit_fixed(graph, [](auto const& fixed) {return fixed.get_graph_iso_num();}) == expected,
+                        "FixedHamiltonian canonical form is wrong for " + describe(graph));
+                    EXPECT(canon.is_canonical(graph) == (graph.get_graph_num() == expected),
+                        "is_canonical is wrong for " + describe(graph));
+
+                    Hamiltonian canonical = graph;
+                    canonical.canonicalize();
+                    EXPECT(canonical.get_graph_num() == expected, "canonicalize is wrong for " + describe(graph));
+                    EXPECT(canon.is_canonical(canonical), "canonicalize gave a graph that isn't canonical for " + describe(graph));
+                }
+            }
+        }
+    }
+
+    void check_chord_index(mt19937&)
+    {
+        for (int nvert = 4; nvert <= 200; nvert++)
+        {
+            unsigned long int next = 0;
+            for (int start = 0; start < nvert; start++)
+            {
+                for (int end = start + 2; end < nvert; end++)
+                {
+                    if (start == 0 && end == nvert - 1) continue;
+                    // Chords are numbered by start, then end, with no gaps
+                    EXPECT(Chord::index(start, end, nvert) == next, "Chord::index skips or repeats at n = " + to_string(nvert));
+                    Chord const chord = Chord::from_index(next, nvert);
+                    EXPECT(chord.get_start() == start && chord.get_end() == end,
+                        "Chord::from_index(" + to_string(next) + ", " + to_string(nvert) + ") isn't (" + to_string(start) + ", " +
+                        to_string(end) + ")");
+                    EXPECT(chord.index() == next, "Chord::index() doesn't undo from_index at n = " + to_string(nvert));
+                    next++;
+                }
+            }
+            EXPECT(next == Chord::max_num_chords(nvert), "max_num_chords is wrong at n = " + to_string(nvert));
+        }
+        // The far end of what's supported, where the index arithmetic is closest to overflowing
+        int const nvert = Chord::max_vertices;
+        for (unsigned long int idx : {0UL, 1UL, 12345UL, Chord::max_num_chords(nvert) / 2, Chord::max_num_chords(nvert) - 1})
+            EXPECT(Chord::from_index(idx, nvert).index() == idx, "Chord::from_index is wrong at n = " + to_string(nvert));
+        for (int small = 0; small < 4; small++) EXPECT(Chord::max_num_chords(small) == 0, "There are chords below 4 vertices");
+    }
+
+    void check_enumeration(mt19937&)
+    {
+        for (auto const& limits : vector<pair<int, int>>{{3, -1}, {4, -1}, {5, -1}, {6, -1}, {7, -1}, {8, -1}, {12, 4}, {20, 3}})
+        {
+            int const nvert = limits.first;
+            string const where = "n = " + to_string(nvert);
+            ChordEnumerator const gen(nvert, 0, limits.second);
+            OrbitCounter const counter(nvert);
+
+            vector<unsigned long long int> found(Chord::max_num_chords(nvert) + 1);
+            set<GraphNumber> seen;
+            gen.for_each([&](Hamiltonian const& graph)
+            {
+                found[graph.get_num_chords()]++;
+                if (nvert > 8) return;
+                EXPECT(graph.get_graph_num() == naive_iso_num(graph), "Enumerator gave a graph that isn't canonical, " + describe(graph));
+                EXPECT(seen.insert(graph.get_graph_num()).second, "Enumerator gave the same graph twice, " + describe(graph));
+            });
+            unsigned long long int total = 0;
+            for (int chords = 0; chords <= gen.get_max_chords(); chords++)
+            {
+                EXPECT(counter.count(chords) == found[chords], where + " has the wrong number of classes with " + to_string(chords) + " chords");
+                total += found[chords];
+            }
+
+            // The other ways of walking the tree have to find the same graphs
+            EnumerationResult const parallel = gen.parallel_classify([](Hamiltonian const& graph) {return graph.get_num_chords() % 2 == 0;}, 4);
+            EXPECT(parallel.num_graphs == total, where + ": parallel_classify saw a different number of graphs");
+            unsigned long long int even = 0;
+            for (size_t chords = 0; chords < found.size(); chords += 2) even += found[chords];
+            EXPECT(parallel.num_matches == even, where + ": parallel_classify matched the wrong number of graphs");
+
+            unsigned long long int sharded = 0;
+            for (int shard = 0; shard < 3; shard++)
+                gen.for_each_in_shard(shard, 3, 2, [&](Hamiltonian const&) {sharded++;}, [](unsigned long long int) {return true;});
+            EXPECT(sharded == total, where + ": shards saw a different number of graphs");
+
+            unsigned long long int lazy = 0;
+            for (auto it = gen.begin(); it != gen.end(); ++it) lazy++;
+            EXPECT(lazy == total, where + ": the iterator saw a different number of graphs");
+        }
+    }
+
+    void check_cycles(mt19937& rng)
+    {
+        for (int nvert = 3; nvert <= 12; nvert++)
+        {
+            for (double density : {0.1, 0.25, 0.5})
+            {
+                for (int trial = 0; trial < 20; trial++)
+                {
+                    Hamiltonian const graph = random_graph(nvert, nvert > 10 ? density / 2 : density, rng);
+                    uint64_t const expected = brute_cycle_lengths(graph);
+                    EXPECT(graph.get_cycle_lengths() == expected, "get_cycle_lengths is wrong for " + describe(graph));
+                    EXPECT(graph.is_pancyclic() == (expected == Hamiltonian::all_cycle_lengths(nvert)),
+                        "is_pancyclic is wrong for " + describe(graph));
+                    boost::dynamic_bitset<> const spectrum = graph.cycle_length_spectrum();
+                    for (int length = 3; length <= nvert; length++)
+                        EXPECT(spectrum[length] == ((expected >> (length - 1)) & 1), "cycle_length_spectrum is wrong for " + describe(graph));
+
+                    // Tracked lengths have to agree after every add_chord and remove_chord, in any order
+                    vector<Chord> chords = graph.chord_vector();
+                    shuffle(chords.begin(), chords.end(), rng);
+                    Hamiltonian tracked(nvert);
+                    tracked.track_cycle_lengths();
+                    for (Chord const& chord : chords)
+                    {
+                        tracked.add_chord(chord);
+                        EXPECT(tracked.get_cycle_lengths() == brute_cycle_lengths(tracked), "Tracked lengths are wrong adding to " + describe(tracked));
+                    }
+                    shuffle(chords.begin(), chords.end(), rng);
+                    for (Chord const& chord : chords)
+                    {
+                        tracked.remove_chord(chord);
+                        EXPECT(tracked.get_cycle_lengths() == brute_cycle_lengths(tracked), "Tracked lengths are wrong removing from " + describe(tracked));
+                    }
+                }
+            }
+        }
+        // 64 vertices, where the length masks are full words
+        for (int trial = 0; trial < 5; trial++)
+        {
+            Hamiltonian graph = random_graph(64, 0.02, rng);
+            Hamiltonian tracked(64);
+            tracked.track_cycle_lengths();
+            for (Chord const& chord : graph.chord_vector()) tracked.add_chord(chord);
+            EXPECT(tracked.get_cycle_lengths() == graph.get_cycle_lengths(), "Tracked lengths are wrong for " + describe(graph));
+        }
+    }
+
+    void check_components(mt19937& rng)
+    {
+        for (int nvert = 4; nvert <= 40; nvert++)
+        {
+            for (double density : {0.05, 0.15, 0.4})
+            {
+                Hamiltonian const graph = random_graph(nvert, density, rng);
+                int const expected = brute_num_components(graph);
+                EXPECT(graph.get_num_crossing_components() == expected, "get_num_crossing_components is wrong for " + describe(graph));
+                EXPECT(static_cast<int>(graph.get_crossing_components().size()) == expected,
+                    "get_crossing_components is wrong for " + describe(graph));
+                CrossingComponents const comps = graph.crossing_components();
+                EXPECT(static_cast<int>(comps.size()) == expected, "crossing_components is wrong for " + describe(graph));
+
+                vector<Chord> chords = graph.chord_vector();
+                shuffle(chords.begin(), chords.end(), rng);
+                Hamiltonian tracked(nvert);
+                tracked.track_crossing_components();
+                for (Chord const& chord : chords)
+                {
+                    tracked.add_chord(chord);
+                    EXPECT(tracked.get_num_crossing_components() == brute_num_components(tracked),
+                        "Tracked components are wrong adding to " + describe(tracked));
+                }
+                for (size_t idx = 0; idx < chords.size(); idx += 3)
+                {
+                    tracked.remove_chord(chords[idx]);
+                    EXPECT(tracked.get_num_crossing_components() == brute_num_components(tracked),
+                        "Tracked components are wrong removing from " + describe(tracked));
+                }
+
+                // Every pair, through each kernel this CPU has
+                for (auto kernel : {CrossingMatrix::SCALAR, CrossingMatrix::AVX2})
+                {
+                    if (!CrossingMatrix::kernel_supported(kernel)) continue;
+                    CrossingMatrix const matrix = Chord::crossing_matrix(chords, kernel);
+                    for (size_t a = 0; a < chords.size(); a++)
+                        for (size_t b = 0; b < chords.size(); b++)
+                            EXPECT(matrix.crossing(a, b) == chords[a].crossing(chords[b]), "Crossing matrix is wrong for " + describe(graph));
+                }
+            }
+        }
+    }
+
+    void check_formats(mt19937& rng)
+    {
+        // Reusing one graph across sizes, with tracking on, which has to survive the change of size
+        Hamiltonian graph6_out(5), sparse6_out(5);
+        graph6_out.track_cycle_lengths();
+        sparse6_out.track_crossing_components();
+        for (int nvert : {3, 4, 5, 6, 7, 10, 11, 62, 63, 64, 65, 100, 300})
+        {
+            for (double density : {0.0, 0.1, 0.5, 1.0})
+            {
+                Hamiltonian const graph = random_graph(nvert, nvert > 64 ? density / 10 : density, rng);
+
+                string const graph6 = graph.to_graph6();
+                EXPECT(Hamiltonian::from_graph6(graph6).get_graph_num() == graph.get_graph_num(), "graph6 doesn't round trip for " + describe(graph));
+                string const sparse6 = graph.to_sparse6();
+                EXPECT(Hamiltonian::from_sparse6(sparse6).get_graph_num() == graph.get_graph_num(), "sparse6 doesn't round trip for " + describe(graph));
+
+                if (nvert > 64) continue;
+                Hamiltonian::from_graph6(graph6.data(), graph6.data() + graph6.size(), graph6_out);
+                EXPECT(graph6_out.get_graph_num() == graph.get_graph_num(), "graph6 doesn't round trip into a reused graph for " + describe(graph));
+                EXPECT(graph6_out.tracking_cycle_lengths() && graph6_out.get_cycle_lengths() == graph.get_cycle_lengths(),
+                    "graph6 lost cycle tracking for " + describe(graph));
+                Hamiltonian::from_sparse6(sparse6.data(), sparse6.data() + sparse6.size(), sparse6_out);
+                EXPECT(sparse6_out.get_graph_num() == graph.get_graph_num(), "sparse6 doesn't round trip into a reused graph for " + describe(graph));
+                EXPECT(sparse6_out.tracking_crossing_components() &&
+                    sparse6_out.get_num_crossing_components() == graph.get_num_crossing_components(),
+                    "sparse6 lost component tracking for " + describe(graph));
+            }
+        }
+
+        // Bad input gets an exception, never a huge graph: too small, too big for the 6 group size, cut off, and
+        // missing a cycle edge
+        for (string const bad : {"A", ":A", "~~~~~~~~", ":~~~~~~~~", "~JSD", "~", "Dx", "D??"})
+        {
+            bool threw = false;
+            try
+            {
+                if (bad[0] == ':') Hamiltonian::from_sparse6(bad);
+                else Hamiltonian::from_graph6(bad);
+            }
+            catch (invalid_argument const&) {threw = true;}
+            EXPECT(threw, "Parsing '" + bad + "' didn't throw");
+        }
+    }
+
+    void check_graph_set(mt19937&)
+    {
+        int const nvert = 8;
+        vector<GraphNumber> graphs;
+        ChordEnumerator(nvert).for_each([&graphs](Hamiltonian const& graph) {graphs.push_back(graph.get_graph_num());});
+
+        // Every thread inserts everything, starting in different places, so the same keys race each other
+        GraphNumberSet set(nvert, 4);
+        int const num_threads = 4;
+        atomic<unsigned long long int> inserted(0);
+        vector<thread> threads;
+        for (int thread_num = 0; thread_num < num_threads; thread_num++)
+        {
+            threads.emplace_back([&, thread_num]
+            {
+                size_t const offset = thread_num * graphs.size() / num_threads;
+                for (size_t idx = 0; idx < graphs.size(); idx++)
+                    if (set.insert(graphs[(idx + offset) % graphs.size()])) inserted++;
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        EXPECT(inserted == graphs.size(), "Concurrent inserts said true " + to_string(inserted.load()) + " times for " +
+            to_string(graphs.size()) + " keys");
+        EXPECT(set.size() == graphs.size(), "GraphNumberSet has the wrong size after concurrent inserts");
+        for (GraphNumber const& num : graphs) EXPECT(set.contains(num), "GraphNumberSet lost a key");
+        size_t visited = 0;
+        set.for_each([&visited](GraphNumberSet::word_type const*) {visited++;});
+        EXPECT(visited == graphs.size(), "GraphNumberSet::for_each saw the wrong number of keys");
+
+        Hamiltonian graph(nvert);
+        graph.add_chord(Chord(0, 2, nvert));
+        EXPECT(!set.insert_canonical(graph), "insert_canonical added a graph that was already there");
+        EXPECT(set.contains(GraphNumber(set.get_num_words())), "GraphNumberSet doesn't have the empty graph");
+    }
+
+    void check_catalog(mt19937&)
+    {
+        int const nvert = 8;
+        filesystem::path const dir = filesystem::temp_directory_path() / ("pancyclic_tests_" + to_string(random_device()()));
+        filesystem::create_directories(dir);
+        string const path = (dir / "test.catalog").string();
+
+        vector<Hamiltonian> graphs;
+        ChordEnumerator(nvert).for_each([&graphs](Hamiltonian const& graph) {graphs.push_back(graph);});
+        {
+            // Backwards and twice over, since the writer has to sort and drop duplicates
+            CatalogWriter writer(path, nvert, true);
+            for (auto graph = graphs.rbegin(); graph != graphs.rend(); ++graph) writer.append(*graph, Catalog::properties_of(*graph));
+            for (Hamiltonian const& graph : graphs) writer.append(graph, Catalog::properties_of(graph));
+            EXPECT(writer.finish() == graphs.size(), "CatalogWriter::finish wrote the wrong number of graphs");
+        }
+        for (auto const& entry : filesystem::directory_iterator(dir))
+            EXPECT(entry.path().string() == path, "CatalogWriter left " + entry.path().string() + " behind");
+
+        {
+            Catalog const catalog(path);
+            OrbitCounter const counter(nvert);
+            EXPECT(catalog.get_num_vertices() == nvert && catalog.size() == graphs.size() && catalog.has_properties(),
+                "Catalog header is wrong");
+            for (int chords = 0; chords <= static_cast<int>(Chord::max_num_chords(nvert)); chords++)
+            {
+                auto const range = catalog.chord_count_range(chords);
+                EXPECT(counter.count(chords) == range.second - range.first, "Catalog has the wrong number of graphs with " +
+                    to_string(chords) + " chords");
+            }
+            for (size_t idx = 1; idx < catalog.size(); idx++)
+            {
+                GraphNumber const prev = catalog.graph_num(idx - 1), cur = catalog.graph_num(idx);
+                EXPECT(prev.popcount() < cur.popcount() || (prev.popcount() == cur.popcount() && prev < cur), "Catalog isn't sorted");
+            }
+            for (Hamiltonian const& graph : graphs)
+            {
+                size_t const idx = catalog.find(graph.get_graph_num());
+                EXPECT(idx != Catalog::npos && catalog.graph_num(idx) == graph.get_graph_num(), "Catalog can't find " + describe(graph));
+                EXPECT(catalog.properties(idx) == Catalog::properties_of(graph), "Catalog has the wrong properties for " + describe(graph));
+            }
+            Hamiltonian noncanonical(nvert);
+            noncanonical.add_chord(Chord(0, 2, nvert));
+            noncanonical.add_chord(Chord(0, 3, nvert));
+            if (noncanonical.get_graph_num() != noncanonical.get_graph_iso_num())
+                EXPECT(!catalog.contains(noncanonical.get_graph_num()), "Catalog found a graph that isn't canonical");
+        }
+
+        // Something that isn't a catalog has to be turned away, not read
+        {
+            ofstream out(path, ios::binary | ios::trunc);
+            out << string(200, 'x');
+        }
+        bool threw = false;
+        try {Catalog const catalog(path);}
+        catch (exception const&) {threw = true;}
+        EXPECT(threw, "Catalog opened a file of garbage");
+
+        // A writer that's never finished leaves nothing behind
+        filesystem::remove(path);
+        {
+            CatalogWriter writer(path, nvert);
+            for (Hamiltonian const& graph : graphs) writer.append(graph);
+        }
+        EXPECT(filesystem::is_empty(dir), "An unfinished CatalogWriter left files behind");
+        filesystem::remove_all(dir);
+    }
+
+    void check_search(mt19937&)
+    {
+        for (int nvert = 3; nvert <= 8; nvert++)
+        {
+            // The fewest chords that make every length, and every class with that many, by looking at all of them
+            int best = -1;
+            vector<GraphNumber> expected;
+            ChordEnumerator(nvert).for_each([&](Hamiltonian const& graph)
+            {
+                if (!graph.is_pancyclic() || (best >= 0 && graph.get_num_chords() > best)) return;
+                if (best < 0 || graph.get_num_chords() < best) expected.clear();
+                best = graph.get_num_chords();
+                expected.push_back(graph.get_graph_num());
+            });
+            sort(expected.begin(), expected.end());
+
+            for (int num_threads : {1, 3})
+            {
+                PancyclicSearch search(nvert, num_threads);
+                PancyclicSearch::Result const result = search.run();
+                string const where = "n = " + to_string(nvert) + " with " + to_string(num_threads) + " threads";
+                EXPECT(result.min_chords == best, where + ": search found " + to_string(result.min_chords) + " chords, not " + to_string(best));
+                EXPECT(result.solutions == expected, where + ": search found the wrong solutions");
+                EXPECT(search.greedy().is_pancyclic(), where + ": the greedy graph isn't pancyclic");
+            }
+        }
+    }
+
+    void check_pool(mt19937&)
+    {
+        // A run that throws can't leave anything behind for the next run on the same pool
+        WorkStealingPool<int> pool(4);
+        atomic<long int> done(0);
+        auto tree = [&](bool throws)
+        {
+            return [&pool, &done, throws](int& depth, int thread)
+            {
+                done++;
+                if (throws && depth == 6 && done > 200) throw runtime_error("planned");
+                if (depth < 10)
+                {
+                    pool.push(depth + 1, thread);
+                    pool.push(depth + 1, thread);
+                }
+            };
+        };
+        for (int round = 0; round < 10; round++)
+        {
+            bool threw = false;
+            try {pool.run({0}, tree(true));}
+            catch (runtime_error const&) {threw = true;}
+            EXPECT(threw, "The pool swallowed an exception");
+            done = 0;
+            pool.run({0}, tree(false));
+            EXPECT(done == 2047, "A run after one that threw did " + to_string(done.load()) + " of 2047 tasks");
+        }
+        done = 0;
+        pool.run({}, tree(false));
+        EXPECT(done == 0, "A run with no tasks did something");
+    }
+
+    void check_cache(mt19937& rng)
+    {
+        int const nvert = 16;
+        vector<Hamiltonian> graphs;
+        for (int idx = 0; idx < 200; idx++) graphs.push_back(random_graph(nvert, 0.1, rng));
+
+        // A cache far too small for the graphs, so it has to evict, and it must never give a wrong answer for it
+        CanonicalCache cache(nvert, 16, 4);
+        for (int pass = 0; pass < 3; pass++)
+        {
+            for (Hamiltonian const& graph : graphs)
+            {
+                EXPECT(cache.canonical_form(graph.get_graph_num()) == naive_iso_num(graph), "Cache is wrong for " + describe(graph));
+            }
+        }
+        EXPECT(cache.size() <= 16, "Cache holds more than its capacity");
+        EXPECT(cache.hits() + cache.misses() == 3 * graphs.size(), "Cache hits and misses don't add up");
+
+        // The global caches, grown after they were made
+        CanonicalCache::set_global_capacity(4);
+        for (Hamiltonian const& graph : graphs) EXPECT(graph.get_graph_iso_num() == naive_iso_num(graph), "Global cache is wrong");
+        CanonicalCache::set_global_capacity(1000);
+        for (int pass = 0; pass < 2; pass++)
+            for (Hamiltonian const& graph : graphs) EXPECT(graph.get_graph_iso_num() == naive_iso_num(graph), "Global cache is wrong");
+        EXPECT(CanonicalCache::global(nvert)->hits() >= graphs.size(), "Global cache didn't keep anything once it grew");
+        CanonicalCache::set_global_capacity(0);
+    }
+
+    struct Check
+    {
+        char const* name;
+        void (*run)(mt19937& rng);
+    };
+
+    Check const checks[] = {
+        {"canonical", check_canonical},
+        {"chord_index", check_chord_index},
+        {"enumeration", check_enumeration},
+        {"cycles", check_cycles},
+        {"components", check_components},
+        {"formats", check_formats},
+        {"graph_set", check_graph_set},
+        {"catalog", check_catalog},
+        {"search", check_search},
+        {"pool", check_pool},
+        {"cache", check_cache},
+    };
+}
+
+
+int main(int argc, char** argv)
+{
+    vector<Check> chosen;
+    for (int arg = 1; arg < argc; arg++)
+    {
+        auto const check = find_if(begin(checks), end(checks), [&](Check const& check) {return !strcmp(check.name, argv[arg]);});
+        if (check == end(checks))
+        {
+            cerr << "No check called " << argv[arg] << ". There's";
+            for (Check const& check : checks) cerr << ' ' << check.name;
+            cerr << endl;
+            return 1;
+        }
+        chosen.push_back(*check);
+    }
+    if (chosen.empty()) chosen.assign(begin(checks), end(checks));
+
+    int failures = 0;
+    for (Check const& check : chosen)
+    {
+        // Each check gets the same random graphs however it's run
+        mt19937 rng(12345);
+        try
+        {
+            check.run(rng);
+            cout << check.name << ": ok" << endl;
+        }
+        catch (exception const& error)
+        {
+            cout << check.name << ": FAILED: " << error.what() << endl;
+            failures++;
+        }
+    }
+    return failures ? 1 : 0;
+}